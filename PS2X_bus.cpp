@@ -0,0 +1,152 @@
+#include "PS2X_bus.h"
+
+#if defined(ARDUINO)
+void PS2XBus::begin(uint8_t clk, uint8_t cmd, uint8_t dat)
+{
+    _clk_pin = clk;
+    _cmd_pin = cmd;
+    _dat_pin = dat;
+#    if defined(SPI_HAS_TRANSACTION)
+    _spi = nullptr;
+#    endif
+}
+#endif
+
+#if defined(SPI_HAS_TRANSACTION)
+void PS2XBus::begin(SPIClass* spi, bool begin)
+{
+    _spi = spi;
+    if (begin)
+        _spi->begin();
+}
+#endif
+
+#if defined(ARDUINO) || defined(SPI_HAS_TRANSACTION)
+uint8_t PS2XBus::addController(PS2XCore& pad, uint8_t att, bool pressures, bool rumble)
+{
+    if (_count >= PS2X_BUS_MAX_CONTROLLERS)
+        return 4;
+
+#    if defined(SPI_HAS_TRANSACTION)
+    if (_spi != nullptr)
+    {
+        // the peripheral is set up once in begin(), not per controller
+        _hardware_spi[_count] = PS2XHardwareSPI(_spi, att, false);
+        return addController(pad, _hardware_spi[_count], pressures, rumble);
+    }
+#    endif
+#    if defined(ARDUINO)
+    _software_spi[_count] = PS2XSoftwareSPI(_clk_pin, _cmd_pin, att, _dat_pin);
+    return addController(pad, _software_spi[_count], pressures, rumble);
+#    else
+    return 4;
+#    endif
+}
+#endif
+
+uint8_t PS2XBus::addController(PS2XCore& pad, PS2XTransport& transport, bool pressures, bool rumble)
+{
+    if (_count >= PS2X_BUS_MAX_CONTROLLERS)
+        return 4;
+
+    uint8_t error = pad.begin(transport, pressures, rumble);
+    if (error != 0)
+        return error;
+
+    Slot& slot = _slots[_count++];
+    slot       = Slot{};
+    slot.pad   = &pad;
+
+    if (_count == 1)
+        _window_start = millis();
+    return 0;
+}
+
+bool PS2XBus::pollSlot(uint8_t index)
+{
+    Slot& slot = _slots[index];
+    if (slot.pad->poll(slot.motor1, slot.motor2) != PS2XCore::PollStatus::Ready)
+        return false;
+
+    slot.frames++;
+    slot.window_frames++;
+    return true;
+}
+
+int8_t PS2XBus::update()
+{
+    if (_count == 0)
+        return -1;
+
+    uint32_t now = millis();
+    if (now - _window_start >= RATE_WINDOW)
+    {
+        uint32_t elapsed = now - _window_start;
+        for (uint8_t i = 0; i < _count; i++)
+        {
+            _slots[i].rate          = static_cast<uint32_t>(_slots[i].window_frames) * 1000 / elapsed;
+            _slots[i].window_frames = 0;
+        }
+        _window_start = now;
+    }
+
+    int8_t ready = -1;
+
+    if (_owner >= 0)
+    {
+        // a packet is in flight, only its controller may clock the bus
+        uint8_t owner = _owner;
+        if (pollSlot(owner))
+            ready = owner;
+        if (!_slots[owner].pad->isPolling())
+        {
+            _owner = -1;
+            _next  = (owner + 1) % _count;
+        }
+        return ready;
+    }
+
+    // bus idle: offer it round robin, the first controller whose packet is
+    // due takes it; the others return right away while waiting out their delays
+    for (uint8_t i = 0; i < _count; i++)
+    {
+        uint8_t index = (_next + i) % _count;
+        if (pollSlot(index))
+            ready = index;
+        if (_slots[index].pad->isPolling())
+        {
+            _owner = index;
+            break;
+        }
+    }
+    return ready;
+}
+
+uint8_t PS2XBus::controllers() const
+{
+    return _count;
+}
+
+PS2XCore& PS2XBus::controller(uint8_t index)
+{
+    return *_slots[index].pad;
+}
+
+void PS2XBus::setMotors(uint8_t index, bool motor1, uint8_t motor2)
+{
+    if (index >= _count)
+        return;
+
+    _slots[index].motor1 = motor1;
+    _slots[index].motor2 = motor2;
+}
+
+uint16_t PS2XBus::frameRate(uint8_t index) const
+{
+    return (index < _count) ? _slots[index].rate : 0;
+}
+
+uint32_t PS2XBus::frames(uint8_t index) const
+{
+    return (index < _count) ? _slots[index].frames : 0;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "PS2X_lib.h"
+
+// maximum number of controllers one PS2XBus schedules
+#ifndef PS2X_BUS_MAX_CONTROLLERS
+#    if defined(__AVR__)
+#        define PS2X_BUS_MAX_CONTROLLERS 4
+#    else
+#        define PS2X_BUS_MAX_CONTROLLERS 8
+#    endif
+#endif
+
+/*
+ * Several controllers sharing CLK/CMD/DAT (or one SPI peripheral), each on
+ * its own ATT line. update() drives all of them through PS2XCore::poll()
+ * and interleaves their packets, so while one controller sits out its packet
+ * delay the bus is already talking to the next one:
+ *
+ *     PS2XBus bus;
+ *     PS2X    pads[4];
+ *     bus.begin(PS2_CLK, PS2_CMD, PS2_DAT);
+ *     for (uint8_t i = 0; i < 4; i++)
+ *         bus.addController(pads[i], att_pins[i], true, true);
+ *     ...
+ *     int8_t pad = bus.update();    // index of a pad with a fresh frame, or -1
+ *
+ * Controllers on a bus must only be read through update(), not readGamepad().
+ * Keep the ATT lines of controllers that aren't added yet high (pull-ups),
+ * otherwise they answer the configuration of the ones added before them.
+ */
+class PS2XBus
+{
+public:
+#if defined(ARDUINO)
+    // software SPI on the shared pins
+    void begin(uint8_t clk, uint8_t cmd, uint8_t dat);
+#endif
+#if defined(SPI_HAS_TRANSACTION)
+    // hardware SPI, begin = false if the SPIClass has already been set up
+    void begin(SPIClass* spi, bool begin = true);
+#endif
+
+#if defined(ARDUINO) || defined(SPI_HAS_TRANSACTION)
+    // configure a controller selected by `att` on the bus set up by begin(),
+    // returns PS2XCore::begin()'s error code or 4 if the bus is full
+    uint8_t addController(PS2XCore& pad, uint8_t att, bool pressures = false, bool rumble = false);
+#endif
+    // same with a transport of its own, e.g. a PS2XSimController
+    uint8_t addController(PS2XCore& pad, PS2XTransport& transport, bool pressures = false, bool rumble = false);
+
+    // advance the bus by at most one byte, returns the index of the controller
+    // that just completed a frame (-1 = none). Call as often as possible.
+    int8_t update();
+
+    uint8_t    controllers() const;
+    PS2XCore&  controller(uint8_t index);
+
+    // motor values sent with every frame of that controller
+    void setMotors(uint8_t index, bool motor1, uint8_t motor2);
+
+    // frames received over the last full second (Hz) / since registration
+    uint16_t frameRate(uint8_t index) const;
+    uint32_t frames(uint8_t index) const;
+
+private:
+    // window frameRate() is measured over (mS)
+    static constexpr uint16_t RATE_WINDOW{1000};
+
+    struct Slot
+    {
+        PS2XCore* pad;
+        bool      motor1;
+        uint8_t   motor2;
+        uint32_t  frames;
+        uint16_t  window_frames;    // frames in the current rate window
+        uint16_t  rate;
+    };
+
+    // poll one controller, true if it completed a frame
+    bool pollSlot(uint8_t index);
+
+    Slot    _slots[PS2X_BUS_MAX_CONTROLLERS]{};
+    uint8_t _count{0};
+    int8_t  _owner{-1};    // controller holding the bus (ATT low)
+    uint8_t _next{0};      // first controller to offer the bus to
+
+    uint32_t _window_start{0};    // millis() of the current rate window
+
+#if defined(ARDUINO)
+    uint8_t         _clk_pin{0};
+    uint8_t         _cmd_pin{0};
+    uint8_t         _dat_pin{0};
+    PS2XSoftwareSPI _software_spi[PS2X_BUS_MAX_CONTROLLERS];    // used by the pin based begin()
+#endif
+#if defined(SPI_HAS_TRANSACTION)
+    SPIClass*       _spi{nullptr};
+    PS2XHardwareSPI _hardware_spi[PS2X_BUS_MAX_CONTROLLERS];    // used by the SPIClass based begin()
+#endif
+};
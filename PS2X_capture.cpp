@@ -0,0 +1,342 @@
+#include "PS2X_capture.h"
+
+namespace
+{
+    constexpr size_t HEADER_SIZE = sizeof(ps2x_capture::MAGIC) + 1;
+
+    // LEB128, at most 5 bytes for a uint32_t
+    uint8_t encodeVarint(uint32_t value, uint8_t* out)
+    {
+        uint8_t n = 0;
+        while (value >= 0x80)
+        {
+            out[n++] = static_cast<uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+        out[n++] = static_cast<uint8_t>(value);
+        return n;
+    }
+
+    bool decodeVarint(const uint8_t* data, size_t len, size_t& pos, uint32_t& value)
+    {
+        value = 0;
+        for (uint8_t shift = 0; shift < 35 && pos < len; shift += 7)
+        {
+            uint8_t b = data[pos++];
+            value |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+}    // namespace
+
+/****************************************************************************************/
+PS2XMemorySink::PS2XMemorySink(uint8_t* buffer, size_t capacity)
+    : _buffer(buffer)
+    , _capacity(capacity)
+{
+}
+
+size_t PS2XMemorySink::write(const uint8_t* data, size_t len)
+{
+    if (len > _capacity - _size)
+        return 0;
+
+    memcpy(_buffer + _size, data, len);
+    _size += len;
+    return len;
+}
+
+const uint8_t* PS2XMemorySink::data() const
+{
+    return _buffer;
+}
+
+size_t PS2XMemorySink::size() const
+{
+    return _size;
+}
+
+void PS2XMemorySink::clear()
+{
+    _size = 0;
+}
+
+#if defined(ARDUINO)
+/****************************************************************************************/
+PS2XPrintSink::PS2XPrintSink(Print& out)
+    : _out(out)
+{
+}
+
+size_t PS2XPrintSink::write(const uint8_t* data, size_t len)
+{
+    return _out.write(data, len);
+}
+#endif
+
+/****************************************************************************************/
+PS2XCapture::PS2XCapture(PS2XTransport& bus, PS2XCaptureSink& sink)
+    : _bus(bus)
+    , _sink(sink)
+{
+}
+
+void PS2XCapture::begin()
+{
+    _bus.begin();
+}
+
+void PS2XCapture::beginTransaction()
+{
+    _bus.beginTransaction();
+}
+
+void PS2XCapture::endTransaction()
+{
+    _bus.endTransaction();
+}
+
+void PS2XCapture::setAttention(bool active)
+{
+    if (active)
+    {
+        _len   = 0;
+        _t_att = micros();
+    }
+    _bus.setAttention(active);
+    if (!active)
+        flush();
+}
+
+uint8_t PS2XCapture::transfer(uint8_t out)
+{
+    uint8_t in = _bus.transfer(out);
+    record(&out, &in, 1);
+    return in;
+}
+
+void PS2XCapture::transferPacket(const uint8_t* out, uint8_t* in, uint8_t len)
+{
+    uint8_t scratch[ps2x_capture::MAX_PACKET];
+    uint8_t* reply = in;
+
+    // keep the transport's own (possibly bulk) path, just make sure we see the reply
+    if (reply == NULL && len <= sizeof(scratch))
+        reply = scratch;
+
+    _bus.transferPacket(out, reply, len);
+    if (reply != NULL)
+        record(out, reply, len);
+}
+
+uint16_t PS2XCapture::byteDelay() const
+{
+    return _bus.byteDelay();
+}
+
+bool PS2XCapture::setByteDelay(uint16_t us)
+{
+    return _bus.setByteDelay(us);
+}
+
+uint32_t PS2XCapture::bitrate() const
+{
+    return _bus.bitrate();
+}
+
+bool PS2XCapture::setBitrate(uint32_t hz)
+{
+    return _bus.setBitrate(hz);
+}
+
+void PS2XCapture::setEnabled(bool enable)
+{
+    _enabled = enable;
+}
+
+uint32_t PS2XCapture::packets() const
+{
+    return _packets;
+}
+
+uint32_t PS2XCapture::dropped() const
+{
+    return _dropped;
+}
+
+void PS2XCapture::record(const uint8_t* out, const uint8_t* in, uint8_t len)
+{
+    if (len > sizeof(_out) - _len)
+        len = sizeof(_out) - _len;
+
+    memcpy(_out + _len, out, len);
+    memcpy(_in + _len, in, len);
+    _len += len;
+}
+
+void PS2XCapture::flush()
+{
+    if (!_enabled || _len == 0)
+        return;
+
+    if (!_header)
+    {
+        uint8_t header[HEADER_SIZE];
+        memcpy(header, ps2x_capture::MAGIC, sizeof(ps2x_capture::MAGIC));
+        header[sizeof(ps2x_capture::MAGIC)] = ps2x_capture::VERSION;
+        if (_sink.write(header, sizeof(header)) != sizeof(header))
+        {
+            _dropped++;
+            return;
+        }
+        _header = true;
+    }
+
+    uint8_t buf[5 + 1 + 2 * ps2x_capture::MAX_PACKET];
+    uint8_t n = encodeVarint(_t_att - _t_last, buf);
+    buf[n++] = _len;
+    memcpy(buf + n, _out, _len);
+    n += _len;
+    memcpy(buf + n, _in, _len);
+    n += _len;
+
+    if (_sink.write(buf, n) == n)
+    {
+        _packets++;
+        _t_last = _t_att;
+    }
+    else
+        _dropped++;
+}
+
+/****************************************************************************************/
+PS2XReplay::PS2XReplay(const uint8_t* data, size_t len)
+    : _data(data)
+    , _len(len)
+{
+    rewind();
+}
+
+void PS2XReplay::begin()
+{
+#if !defined(ARDUINO)
+    // start the way the capture did, PS2X::begin() checks the clock before its first packet
+    size_t   pos = HEADER_SIZE;
+    uint32_t first;
+    if (_valid && decodeVarint(_data, _len, pos, first))
+        ps2x_host::setClock(first);
+#endif
+}
+
+void PS2XReplay::beginTransaction()
+{
+}
+
+void PS2XReplay::endTransaction()
+{
+}
+
+void PS2XReplay::setAttention(bool active)
+{
+    if (active == _attention)
+        return;
+
+    _attention = active;
+    if (active)
+    {
+        _pos      = 0;
+        _mismatch = false;
+        if (!nextRecord())
+            _rec_len = 0;
+#if !defined(ARDUINO)
+        else
+            ps2x_host::setClock(_time);    // PS2X sees the recorded timing
+#endif
+    }
+    else if (_rec_len != 0)
+    {
+        _packets++;
+        if (_mismatch || _pos != _rec_len)
+            _mismatches++;
+    }
+}
+
+uint8_t PS2XReplay::transfer(uint8_t out)
+{
+    if (!_attention || _pos >= _rec_len)
+    {
+        if (_attention && _rec_len != 0)
+            _mismatch = true;    // longer than recorded
+        return 0xFF;
+    }
+
+    if (out != _out[_pos])
+        _mismatch = true;
+    return _in[_pos++];
+}
+
+bool PS2XReplay::valid() const
+{
+    return _valid;
+}
+
+bool PS2XReplay::finished() const
+{
+    return !_valid || _next >= _len;
+}
+
+void PS2XReplay::rewind()
+{
+    _valid = _len >= HEADER_SIZE && memcmp(_data, ps2x_capture::MAGIC, sizeof(ps2x_capture::MAGIC)) == 0
+             && _data[sizeof(ps2x_capture::MAGIC)] == ps2x_capture::VERSION;
+    _next       = HEADER_SIZE;
+    _rec_len    = 0;
+    _time       = 0;
+    _packets    = 0;
+    _mismatches = 0;
+}
+
+uint32_t PS2XReplay::packets() const
+{
+    return _packets;
+}
+
+uint32_t PS2XReplay::mismatches() const
+{
+    return _mismatches;
+}
+
+uint32_t PS2XReplay::packetTime() const
+{
+    return _time;
+}
+
+bool PS2XReplay::nextRecord()
+{
+    if (finished())
+        return false;
+
+    size_t   pos = _next;
+    uint32_t dt;
+    if (!decodeVarint(_data, _len, pos, dt) || pos >= _len)
+    {
+        _next = _len;    // truncated stream
+        return false;
+    }
+
+    uint8_t len = _data[pos++];
+    if (_len - pos < 2u * len)
+    {
+        _next = _len;
+        return false;
+    }
+
+    _time += dt;
+    _rec_len = len;
+    _out     = _data + pos;
+    _in      = _data + pos + len;
+    _next    = pos + 2u * len;
+    return true;
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "PS2X_transport.h"
+
+/*
+ * Raw bus capture and replay. PS2XCapture sits between PS2X and the real
+ * transport and records every packet - command bytes, reply bytes and the
+ * time ATT went low - to a PS2XCaptureSink. PS2XReplay plays such a
+ * recording back as a transport, so readGamepad() and all accessors see the
+ * exact frames the controller sent. On a host with ps2x_host's virtual clock
+ * the replay also sets the clock to the recorded time of each packet, so all
+ * timing decisions (read delay, stale frame reconfiguration, ...) repeat too:
+ *
+ *     PS2XSoftwareSPI    bus(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT);
+ *     PS2XPrintSink      sink(Serial);
+ *     PS2XCapture        capture(bus, sink);
+ *     ps2x.begin(capture, true, true);
+ *
+ *     PS2XReplay replay(trace, trace_len);
+ *     ps2x.begin(replay, true, true);
+ *
+ * Stream format: "PS2C" and a version byte, then one record per packet:
+ *     varint   uS since the previous packet, the first one holds micros() (LEB128)
+ *     uint8_t  packet length n
+ *     uint8_t  command bytes [n]
+ *     uint8_t  reply bytes [n]
+ */
+
+// receives the capture stream, one complete header or record per write()
+class PS2XCaptureSink
+{
+public:
+    // returns the number of bytes taken, a short write drops the record
+    virtual size_t write(const uint8_t* data, size_t len) = 0;
+
+protected:
+    ~PS2XCaptureSink() = default;
+};
+
+// capture into a caller supplied buffer, records that don't fit are dropped
+class PS2XMemorySink : public PS2XCaptureSink
+{
+public:
+    PS2XMemorySink(uint8_t* buffer, size_t capacity);
+
+    size_t write(const uint8_t* data, size_t len) override;
+
+    const uint8_t* data() const;
+    size_t         size() const;
+    void           clear();
+
+private:
+    uint8_t* _buffer;
+    size_t   _capacity;
+    size_t   _size{0};
+};
+
+#if defined(ARDUINO)
+// capture to any Print, e.g. Serial or an SD card File
+class PS2XPrintSink : public PS2XCaptureSink
+{
+public:
+    explicit PS2XPrintSink(Print& out);
+
+    size_t write(const uint8_t* data, size_t len) override;
+
+private:
+    Print& _out;
+};
+#endif
+
+namespace ps2x_capture
+{
+    constexpr uint8_t MAGIC[4]   = {'P', 'S', '2', 'C'};
+    constexpr uint8_t VERSION    = 1;
+    constexpr uint8_t MAX_PACKET = 64;    // longer packets are cut off
+}    // namespace ps2x_capture
+
+// forwards everything to `bus` and records each packet to `sink`
+class PS2XCapture : public PS2XTransport
+{
+public:
+    PS2XCapture(PS2XTransport& bus, PS2XCaptureSink& sink);
+
+    void    begin() override;
+    void    beginTransaction() override;
+    void    endTransaction() override;
+    void    setAttention(bool active) override;
+    uint8_t transfer(uint8_t out) override;
+    void    transferPacket(const uint8_t* out, uint8_t* in, uint8_t len) override;
+
+    uint16_t byteDelay() const override;
+    bool     setByteDelay(uint16_t us) override;
+    uint32_t bitrate() const override;
+    bool     setBitrate(uint32_t hz) override;
+
+    // stop / resume recording, packets in between are still forwarded
+    void setEnabled(bool enable);
+
+    uint32_t packets() const;    // records written
+    uint32_t dropped() const;    // records the sink didn't take
+
+private:
+    void record(const uint8_t* out, const uint8_t* in, uint8_t len);
+    void flush();
+
+    PS2XTransport&   _bus;
+    PS2XCaptureSink& _sink;
+    bool             _enabled{true};
+    bool             _header{false};    // stream header written
+
+    uint8_t  _out[ps2x_capture::MAX_PACKET];
+    uint8_t  _in[ps2x_capture::MAX_PACKET];
+    uint8_t  _len{0};
+    uint32_t _t_att{0};     // micros() of the current packet
+    uint32_t _t_last{0};    // micros() of the previous record
+
+    uint32_t _packets{0};
+    uint32_t _dropped{0};
+};
+
+// plays a capture stream back packet by packet, in recorded order
+class PS2XReplay : public PS2XTransport
+{
+public:
+    // data must stay valid while replaying, it is not copied
+    PS2XReplay(const uint8_t* data, size_t len);
+
+    void    begin() override;
+    void    beginTransaction() override;
+    void    endTransaction() override;
+    void    setAttention(bool active) override;
+    uint8_t transfer(uint8_t out) override;
+
+    // false if the stream header is missing or has an unknown version
+    bool valid() const;
+    // all packets played, the bus reads back 0xFF (nothing connected) from now on
+    bool finished() const;
+    void rewind();
+
+    uint32_t packets() const;       // packets played so far
+    uint32_t mismatches() const;    // packets whose commands differ from the recording
+    uint32_t packetTime() const;    // recorded micros() of the current packet
+
+private:
+    bool nextRecord();
+
+    const uint8_t* _data;
+    size_t         _len;
+    size_t         _next{0};    // offset of the next record
+    bool           _valid{false};
+
+    const uint8_t* _out{nullptr};    // current record
+    const uint8_t* _in{nullptr};
+    uint8_t        _rec_len{0};
+    uint8_t        _pos{0};
+    bool           _attention{false};
+    bool           _mismatch{false};
+    uint32_t       _time{0};    // recorded micros() of the current packet
+
+    uint32_t _packets{0};
+    uint32_t _mismatches{0};
+};
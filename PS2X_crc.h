@@ -0,0 +1,16 @@
+#pragma once
+
+#include "PS2X_platform.h"
+
+// CRC-8 with polynomial 0x07 (CRC-8/SMBUS), pass the previous result as crc
+// to continue over several buffers
+inline uint8_t ps2x_crc8(const uint8_t* data, size_t len, uint8_t crc = 0)
+{
+    while (len--)
+    {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
+    }
+    return crc;
+}
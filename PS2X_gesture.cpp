@@ -0,0 +1,259 @@
+#include "PS2X_gesture.h"
+
+using namespace ps2x_gesture;
+
+namespace
+{
+    bool singleButton(uint16_t keys)
+    {
+        return keys != 0 && (keys & (keys - 1)) == 0;
+    }
+
+    // index of the lowest set bit
+    uint8_t lowestBit(uint32_t bits)
+    {
+        return __builtin_ctzl(bits);
+    }
+
+    // wrap safe a < b for millis()
+    bool before(uint32_t a, uint32_t b)
+    {
+        return static_cast<int32_t>(a - b) < 0;
+    }
+}    // namespace
+
+PS2XGestureEngine::PS2XGestureEngine(const Buffers& buffers)
+    : _b(buffers)
+{
+}
+
+uint8_t PS2XGestureEngine::add(const Pattern& pattern)
+{
+    return add(&pattern, 1);
+}
+
+uint8_t PS2XGestureEngine::add(const Pattern* patterns, uint8_t count)
+{
+    // check the whole table first, it goes in completely or not at all
+    uint16_t steps = 0;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const Pattern& p = patterns[i];
+        if (p.kind == Kind::Chord)
+        {
+            if (p.keys[0] == 0)
+                return NONE;
+        }
+        else
+        {
+            if (p.length == 0 || p.length > MAX_STEPS)
+                return NONE;
+            for (uint8_t s = 0; s < p.length; s++)
+            {
+                if (!singleButton(p.keys[s]))
+                    return NONE;
+            }
+            steps += p.length;
+        }
+    }
+    if (count == 0 || _count + count > _b.capacity || _steps + steps > _b.steps)
+        return NONE;
+
+    uint8_t first = _count;
+    for (uint8_t i = 0; i < count; i++)
+    {
+        const Pattern& p  = patterns[i];
+        uint8_t        id = _count++;
+
+        if (p.kind == Kind::Chord)
+        {
+            uint8_t  c   = _chords++;
+            uint8_t  w   = c / 32;
+            uint32_t bit = 1UL << (c % 32);
+
+            for (uint8_t n = 0; n < 16; n++)
+            {
+                bool needed = (p.keys[0] >> n) & 1;
+                if (!needed)
+                    _b.chord_ok[(n * 2 + 0) * _b.chord_words + w] |= bit;
+                if (needed || !p.exact)
+                    _b.chord_ok[(n * 2 + 1) * _b.chord_words + w] |= bit;
+            }
+            _b.chord_hold[c] = p.hold;
+            _b.chord_id[c]   = id;
+        }
+        else
+        {
+            for (uint8_t s = 0; s < p.length; s++)
+            {
+                uint16_t j = _steps++;
+                _b.step_match[lowestBit(p.keys[s]) * _b.step_words + j / 32] |= 1UL << (j % 32);
+                if (s == 0)
+                    _b.step_first[j / 32] |= 1UL << (j % 32);
+            }
+            uint16_t last = _steps - 1;
+            _b.step_last[last / 32] |= 1UL << (last % 32);
+            _b.step_id[last] = id;
+        }
+    }
+
+    return first;
+}
+
+void PS2XGestureEngine::clear()
+{
+    memset(_b.chord_ok, 0, sizeof(uint32_t) * 16 * 2 * _b.chord_words);
+    memset(_b.step_match, 0, sizeof(uint32_t) * 16 * _b.step_words);
+    memset(_b.step_first, 0, sizeof(uint32_t) * _b.step_words);
+    memset(_b.step_last, 0, sizeof(uint32_t) * _b.step_words);
+
+    _count  = 0;
+    _chords = 0;
+    _steps  = 0;
+    reset();
+}
+
+uint8_t PS2XGestureEngine::size() const
+{
+    return _count;
+}
+
+void PS2XGestureEngine::reset()
+{
+    memset(_b.chord_held, 0, sizeof(uint32_t) * _b.chord_words);
+    memset(_b.chord_fired, 0, sizeof(uint32_t) * _b.chord_words);
+    memset(_b.step_state, 0, sizeof(uint32_t) * _b.step_words);
+
+    _pressed       = 0;
+    _holds_pending = false;
+}
+
+void PS2XGestureEngine::setSequenceGap(uint16_t ms)
+{
+    _gap = ms;
+}
+
+void PS2XGestureEngine::setCallback(Callback callback, void* arg)
+{
+    _callback = callback;
+    _arg      = arg;
+}
+
+bool PS2XGestureEngine::readEvent(Event& event)
+{
+    return _events.pop(event);
+}
+
+uint32_t PS2XGestureEngine::eventOverflows() const
+{
+    return _events.overflows();
+}
+
+void PS2XGestureEngine::fire(uint8_t id, uint32_t now)
+{
+    if (_callback != nullptr)
+        _callback(id, _arg);
+    else
+        _events.push(Event{id, now});
+}
+
+void PS2XGestureEngine::update(uint16_t pressed, uint32_t now)
+{
+    uint16_t down = pressed & ~_pressed;
+
+    if (pressed != _pressed)
+        updateChords(pressed, now);
+    else if (_holds_pending && !before(now, _next_due))
+        checkHolds(now);
+
+    // one sequence step per new press, in button order
+    for (; down != 0; down &= down - 1)
+        stepSequences(lowestBit(down), now);
+
+    _pressed = pressed;
+}
+
+void PS2XGestureEngine::updateChords(uint16_t pressed, uint32_t now)
+{
+    uint8_t words = (_chords + 31) / 32;
+
+    for (uint8_t w = 0; w < words; w++)
+    {
+        // chords every button state allows
+        uint32_t held = 0xFFFF'FFFFUL;
+        for (uint8_t n = 0; n < 16; n++)
+            held &= _b.chord_ok[(n * 2 + ((pressed >> n) & 1)) * _b.chord_words + w];
+
+        uint32_t started = held & ~_b.chord_held[w];
+        _b.chord_held[w] = held;
+        _b.chord_fired[w] &= held;    // released chords can fire again
+
+        for (; started != 0; started &= started - 1)
+        {
+            uint8_t c         = w * 32 + lowestBit(started);
+            _b.chord_since[c] = now;
+            if (_b.chord_hold[c] == 0)
+            {
+                _b.chord_fired[w] |= 1UL << (c % 32);
+                fire(_b.chord_id[c], now);
+            }
+            else if (!_holds_pending || before(now + _b.chord_hold[c], _next_due))
+            {
+                _holds_pending = true;
+                _next_due      = now + _b.chord_hold[c];
+            }
+        }
+    }
+
+    if (_holds_pending && !before(now, _next_due))
+        checkHolds(now);
+}
+
+void PS2XGestureEngine::checkHolds(uint32_t now)
+{
+    uint8_t words  = (_chords + 31) / 32;
+    _holds_pending = false;
+
+    for (uint8_t w = 0; w < words; w++)
+    {
+        for (uint32_t waiting = _b.chord_held[w] & ~_b.chord_fired[w]; waiting != 0; waiting &= waiting - 1)
+        {
+            uint8_t  c   = w * 32 + lowestBit(waiting);
+            uint32_t due = _b.chord_since[c] + _b.chord_hold[c];
+            if (!before(now, due))
+            {
+                _b.chord_fired[w] |= 1UL << (c % 32);
+                fire(_b.chord_id[c], now);
+            }
+            else if (!_holds_pending || before(due, _next_due))
+            {
+                _holds_pending = true;
+                _next_due      = due;
+            }
+        }
+    }
+}
+
+void PS2XGestureEngine::stepSequences(uint8_t button, uint32_t now)
+{
+    uint8_t words = (_steps + 31) / 32;
+    if (words == 0)
+        return;
+
+    // a pause too long breaks every partial sequence
+    bool     expired = _gap != 0 && now - _t_press > _gap;
+    uint32_t carry   = 0;
+
+    const uint32_t* match = _b.step_match + button * _b.step_words;
+    for (uint8_t w = 0; w < words; w++)
+    {
+        uint32_t state   = expired ? 0 : _b.step_state[w];
+        uint32_t next    = ((state << 1) | carry | _b.step_first[w]) & match[w];
+        carry            = state >> 31;
+        _b.step_state[w] = next;
+
+        for (uint32_t done = next & _b.step_last[w]; done != 0; done &= done - 1)
+            fire(_b.step_id[w * 32 + lowestBit(done)], now);
+    }
+    _t_press = now;
+}
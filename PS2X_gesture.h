@@ -0,0 +1,209 @@
+#pragma once
+
+#include "PS2X_lib.h"
+
+// gestures buffered for readEvent()
+#ifndef PS2X_GESTURE_QUEUE_SIZE
+#    define PS2X_GESTURE_QUEUE_SIZE 8
+#endif
+
+/*
+ * Gesture declarations. Patterns are plain constexpr values, so a whole set
+ * can live in a const table:
+ *
+ *     using namespace ps2x_gesture;
+ *     constexpr Pattern COMBOS[] = {
+ *         chord(2000, PS2X::Button::L1, PS2X::Button::R1, PS2X::Button::Start),
+ *         sequence(PS2X::Button::Pad_Up, PS2X::Button::Pad_Up, PS2X::Button::Pad_Down, PS2X::Button::Pad_Down),
+ *     };
+ */
+namespace ps2x_gesture
+{
+    constexpr uint8_t MAX_STEPS = 12;      // buttons in one sequence
+    constexpr uint8_t NONE      = 0xFF;    // add() found no room
+
+    enum class Kind : uint8_t
+    {
+        Chord,       // buttons held together
+        Sequence     // buttons pressed one after the other
+    };
+
+    struct Pattern
+    {
+        Kind     kind;
+        uint8_t  length;             // sequence steps
+        bool     exact;              // chord: no other button may be held
+        uint16_t hold;               // chord: held this long before it fires (mS)
+        uint16_t keys[MAX_STEPS];    // chord: keys[0] = button mask, sequence: one button per step
+    };
+
+    constexpr uint16_t mask()
+    {
+        return 0;
+    }
+
+    template <class... Rest>
+    constexpr uint16_t mask(PS2XCore::Button button, Rest... rest)
+    {
+        return static_cast<uint16_t>(button) | mask(rest...);
+    }
+
+    // all buttons held for hold_ms (0 = fires on the press), others may be held too
+    template <class... Buttons>
+    constexpr Pattern chord(uint16_t hold_ms, Buttons... buttons)
+    {
+        return Pattern{Kind::Chord, 0, false, hold_ms, {mask(buttons...)}};
+    }
+
+    // exactly these buttons held
+    template <class... Buttons>
+    constexpr Pattern exactChord(uint16_t hold_ms, Buttons... buttons)
+    {
+        return Pattern{Kind::Chord, 0, true, hold_ms, {mask(buttons...)}};
+    }
+
+    // buttons pressed in this order with no other press in between
+    template <class... Steps>
+    constexpr Pattern sequence(Steps... steps)
+    {
+        static_assert(sizeof...(Steps) > 0 && sizeof...(Steps) <= MAX_STEPS, "a sequence has 1 to MAX_STEPS steps");
+        return Pattern{Kind::Sequence, sizeof...(Steps), false, 0, {static_cast<uint16_t>(steps)...}};
+    }
+}    // namespace ps2x_gesture
+
+
+/*
+ * Chord and sequence recognizer, run on the pressed buttons of every frame
+ * (attach it with PS2XCore::attachGestures(), or call update() yourself).
+ *
+ * All patterns are evaluated at once as bitsets, one bit per chord / per
+ * sequence step, 32 per word:
+ *  - chords: for each button and its up/down state a precomputed set of the
+ *    chords that state allows, AND-ed over the 16 buttons when the buttons
+ *    change; only chords with a hold time still running are visited, and
+ *    only once the earliest of them is due
+ *  - sequences: Shift-And over the concatenated steps of all sequences, one
+ *    shift per new press
+ * so a frame costs a few operations per word of patterns, whatever matches.
+ *
+ * Use PS2XGestures<Patterns, Steps> for the storage. Chords added while
+ * their buttons are held start with the next button change. Not locked: add
+ * patterns before attaching, read events from one task.
+ */
+class PS2XGestureEngine
+{
+public:
+    struct Event
+    {
+        uint8_t  id;           // as returned by add()
+        uint32_t timestamp;    // millis() of the frame that completed it
+    };
+
+    using Callback = void (*)(uint8_t id, void* arg);
+
+    PS2XGestureEngine(const PS2XGestureEngine&)            = delete;
+    PS2XGestureEngine& operator=(const PS2XGestureEngine&) = delete;
+
+    // id of the pattern, ps2x_gesture::NONE if it doesn't fit or is invalid.
+    // A table is added as a whole with consecutive ids, the first is returned.
+    uint8_t add(const ps2x_gesture::Pattern& pattern);
+    uint8_t add(const ps2x_gesture::Pattern* patterns, uint8_t count);
+    void    clear();
+    uint8_t size() const;
+
+    // longest pause between two steps of a sequence (mS, 0 = no limit),
+    // 500 by default
+    void setSequenceGap(uint16_t ms);
+
+    // completed gestures go to callback (called from update(), i.e. from the
+    // task that reads the controller) or, without one, to readEvent()
+    void     setCallback(Callback callback, void* arg = nullptr);
+    bool     readEvent(Event& event);
+    uint32_t eventOverflows() const;
+
+    // pressed buttons of a frame (PS2XCore::Button bits, 1 = pressed) at now (millis())
+    void update(uint16_t pressed, uint32_t now);
+
+    // forget held chords and partial sequences
+    void reset();
+
+protected:
+    // storage of a PS2XGestures, sized by its template arguments
+    struct Buffers
+    {
+        uint8_t   capacity;       // patterns
+        uint16_t  steps;          // sequence steps
+        uint8_t   chord_words;    // (capacity + 31) / 32
+        uint8_t   step_words;     // (steps + 31) / 32
+        uint32_t* chord_ok;       // [16][2][chord_words]: chords allowing button n up (0) / down (1)
+        uint32_t* chord_held;     // [chord_words]: satisfied by the current buttons
+        uint32_t* chord_fired;    // [chord_words]: fired since they became satisfied
+        uint32_t* chord_since;    // [capacity]: millis() they became satisfied
+        uint16_t* chord_hold;     // [capacity]
+        uint8_t*  chord_id;       // [capacity]
+        uint32_t* step_match;     // [16][step_words]: steps expecting button n
+        uint32_t* step_first;     // [step_words]
+        uint32_t* step_last;      // [step_words]
+        uint32_t* step_state;     // [step_words]: steps matched by the latest presses
+        uint8_t*  step_id;        // [steps]: pattern of a last step
+    };
+
+    explicit PS2XGestureEngine(const Buffers& buffers);
+
+private:
+    void fire(uint8_t id, uint32_t now);
+    void updateChords(uint16_t pressed, uint32_t now);
+    void checkHolds(uint32_t now);
+    void stepSequences(uint8_t button, uint32_t now);
+
+    Buffers _b;
+
+    uint8_t  _count{0};     // patterns added
+    uint8_t  _chords{0};    // chord slots used
+    uint16_t _steps{0};     // sequence steps used
+
+    uint16_t _pressed{0};
+    uint16_t _gap{500};
+    uint32_t _t_press{0};              // millis() of the latest press
+    bool     _holds_pending{false};    // held chords still waiting for their hold time
+    uint32_t _next_due{0};             // millis() the earliest of them fires
+
+    Callback _callback{nullptr};
+    void*    _arg{nullptr};
+
+    PS2XRing<Event, PS2X_GESTURE_QUEUE_SIZE> _events;
+};
+
+// recognizer with room for Patterns patterns (up to 254) and Steps sequence
+// steps in total
+template <uint8_t Patterns, uint16_t Steps = Patterns * 4>
+class PS2XGestures : public PS2XGestureEngine
+{
+    static_assert(Patterns > 0 && Patterns < ps2x_gesture::NONE, "Patterns must be 1-254");
+    static_assert(Steps > 0 && Steps <= 4096, "Steps must be 1-4096");
+
+    static constexpr uint8_t CHORD_WORDS = (Patterns + 31) / 32;
+    static constexpr uint8_t STEP_WORDS  = (Steps + 31) / 32;
+
+public:
+    PS2XGestures()
+        : PS2XGestureEngine(Buffers{Patterns, Steps, CHORD_WORDS, STEP_WORDS,
+                                    &_chord_ok[0][0][0], _chord_held, _chord_fired, _chord_since, _chord_hold, _chord_id,
+                                    &_step_match[0][0], _step_first, _step_last, _step_state, _step_id})
+    {
+    }
+
+private:
+    uint32_t _chord_ok[16][2][CHORD_WORDS]{};
+    uint32_t _chord_held[CHORD_WORDS]{};
+    uint32_t _chord_fired[CHORD_WORDS]{};
+    uint32_t _chord_since[Patterns]{};
+    uint16_t _chord_hold[Patterns]{};
+    uint8_t  _chord_id[Patterns]{};
+
+    uint32_t _step_match[16][STEP_WORDS]{};
+    uint32_t _step_first[STEP_WORDS]{};
+    uint32_t _step_last[STEP_WORDS]{};
+    uint32_t _step_state[STEP_WORDS]{};
+    uint8_t  _step_id[Steps]{};
+};
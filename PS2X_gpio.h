@@ -0,0 +1,185 @@
+#pragma once
+
+#include "PS2X_platform.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "soc/gpio_reg.h"
+#include "soc/soc.h"
+#endif
+
+/*
+ * Fast GPIO access for the software SPI transports.
+ *
+ * write<Pin>()/read<Pin>() are for pins known at compile time: on ESP32 and
+ * ESP8266 the pin numbers turn into constant register addresses and masks, so
+ * a pin write is a single store instead of a digitalWrite() call. Every other
+ * core - AVR included - falls back to digitalWrite()/digitalRead(), so there
+ * the constant pins save the pin lookup of FastPin but not the call.
+ */
+namespace ps2x_gpio
+{
+#if defined(ARDUINO)
+    template <uint8_t Pin>
+    inline void write(bool high)
+    {
+#if defined(ARDUINO_ARCH_ESP32)
+        if (Pin < 32)
+            REG_WRITE(high ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, 1UL << (Pin & 31));
+#    if defined(GPIO_OUT1_W1TS_REG)
+        else
+            REG_WRITE(high ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, 1UL << (Pin & 31));
+#    endif
+#elif defined(ARDUINO_ARCH_ESP8266)
+        if (Pin < 16)
+        {
+            if (high)
+                GPOS = (1 << Pin);
+            else
+                GPOC = (1 << Pin);
+        }
+        else
+            digitalWrite(Pin, high ? HIGH : LOW);
+#else
+        digitalWrite(Pin, high ? HIGH : LOW);
+#endif
+    }
+
+    template <uint8_t Pin>
+    inline bool read()
+    {
+#if defined(ARDUINO_ARCH_ESP32)
+#    if defined(GPIO_IN1_REG)
+        if (Pin >= 32)
+            return (REG_READ(GPIO_IN1_REG) >> (Pin & 31)) & 1;
+#    endif
+        return (REG_READ(GPIO_IN_REG) >> (Pin & 31)) & 1;
+#elif defined(ARDUINO_ARCH_ESP8266)
+        if (Pin < 16)
+            return GPIP(Pin);
+        return digitalRead(Pin) ? true : false;
+#else
+        return digitalRead(Pin) ? true : false;
+#endif
+    }
+
+    /*
+     * GPIO access for pins chosen at runtime: register addresses and bit masks
+     * are looked up once in attach(), every write/read afterwards is a plain
+     * register access (ESP32, ESP8266 pins 0-15, AVR). Other cores and pins
+     * fall back to digitalWrite()/digitalRead().
+     */
+    class FastPin
+    {
+    public:
+        void attach(uint8_t pin)
+        {
+            _pin = pin;
+#if defined(ARDUINO_ARCH_ESP32)
+            _mask = 1UL << (pin & 31);
+#    if defined(GPIO_OUT1_W1TS_REG)
+            if (pin >= 32)
+            {
+                _set = reinterpret_cast<volatile uint32_t*>(GPIO_OUT1_W1TS_REG);
+                _clr = reinterpret_cast<volatile uint32_t*>(GPIO_OUT1_W1TC_REG);
+                _in  = reinterpret_cast<volatile uint32_t*>(GPIO_IN1_REG);
+                return;
+            }
+#    endif
+            _set = reinterpret_cast<volatile uint32_t*>(GPIO_OUT_W1TS_REG);
+            _clr = reinterpret_cast<volatile uint32_t*>(GPIO_OUT_W1TC_REG);
+            _in  = reinterpret_cast<volatile uint32_t*>(GPIO_IN_REG);
+#elif defined(ARDUINO_ARCH_ESP8266)
+            _fast = (pin < 16);
+            _mask = 1UL << (pin & 15);
+#elif defined(__AVR__)
+            _mask = digitalPinToBitMask(pin);
+            _out  = portOutputRegister(digitalPinToPort(pin));
+            _in   = portInputRegister(digitalPinToPort(pin));
+#endif
+        }
+
+        inline void write(bool high) const
+        {
+#if defined(ARDUINO_ARCH_ESP32)
+            *(high ? _set : _clr) = _mask;
+#elif defined(ARDUINO_ARCH_ESP8266)
+            if (!_fast)
+                digitalWrite(_pin, high ? HIGH : LOW);
+            else if (high)
+                GPOS = _mask;
+            else
+                GPOC = _mask;
+#elif defined(__AVR__)
+            // read-modify-write of a shared port, keep interrupts from sneaking in
+            uint8_t sreg = SREG;
+            cli();
+            if (high)
+                *_out |= _mask;
+            else
+                *_out &= ~_mask;
+            SREG = sreg;
+#else
+            digitalWrite(_pin, high ? HIGH : LOW);
+#endif
+        }
+
+        inline bool read() const
+        {
+#if defined(ARDUINO_ARCH_ESP32)
+            return (*_in & _mask) != 0;
+#elif defined(ARDUINO_ARCH_ESP8266)
+            return _fast ? ((GPI & _mask) != 0) : (digitalRead(_pin) ? true : false);
+#elif defined(__AVR__)
+            return (*_in & _mask) != 0;
+#else
+            return digitalRead(_pin) ? true : false;
+#endif
+        }
+
+    private:
+        uint8_t _pin{0};
+#if defined(ARDUINO_ARCH_ESP32)
+        volatile uint32_t* _set{NULL};
+        volatile uint32_t* _clr{NULL};
+        volatile uint32_t* _in{NULL};
+        uint32_t           _mask{0};
+#elif defined(ARDUINO_ARCH_ESP8266)
+        bool     _fast{false};
+        uint32_t _mask{0};
+#elif defined(__AVR__)
+        volatile uint8_t* _out{NULL};
+        volatile uint8_t* _in{NULL};
+        uint8_t           _mask{0};
+#endif
+    };
+
+    /*
+     * Short busy waits. On ESP32/ESP8266 a tick is a CPU cycle, so waits below
+     * 1uS are possible; elsewhere a tick is a microsecond (rounded up).
+     */
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+    inline uint32_t nsToTicks(uint32_t ns)
+    {
+        return ns * ESP.getCpuFreqMHz() / 1000;
+    }
+
+    inline void delayTicks(uint32_t ticks)
+    {
+        uint32_t start = ESP.getCycleCount();
+        while (ESP.getCycleCount() - start < ticks)
+            ;
+    }
+#else
+    inline uint32_t nsToTicks(uint32_t ns)
+    {
+        return (ns + 999) / 1000;
+    }
+
+    inline void delayTicks(uint32_t ticks)
+    {
+        if (ticks != 0)
+            delayMicroseconds(ticks);
+    }
+#endif
+#endif
+}    // namespace ps2x_gpio
@@ -1,4 +1,6 @@
 #include "PS2X_lib.h"
+#include "PS2X_gesture.h"
+#include "PS2X_storage.h"
 #include <math.h>
 
 #define SET(x, y) (x |= (1 << y))
@@ -7,264 +9,889 @@
 #define TOG(x, y) (x ^= (1 << y))
 #define U16C(x)   (static_cast<uint16_t>(x))
 
+#ifdef PS2X_STATS
+#    define PS2X_STAT(x) x
+#else
+#    define PS2X_STAT(x)
+#endif
+
 namespace
 {
-    constexpr uint8_t enter_config[]    = {0x01, 0x43, 0x00, 0x01, 0x00};
-    constexpr uint8_t set_mode[]        = {0x01, 0x44, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00};
-    constexpr uint8_t set_bytes_large[] = {0x01, 0x4F, 0x00, 0xFF, 0xFF, 0x03, 0x00, 0x00, 0x00};
-    constexpr uint8_t exit_config[]     = {0x01, 0x43, 0x00, 0x00, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A};
-    constexpr uint8_t enable_rumble[]   = {0x01, 0x4D, 0x00, 0x00, 0x01};
-    constexpr uint8_t type_read[]       = {0x01, 0x45, 0x00, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A};
+    constexpr uint8_t enter_config[]     = {0x01, 0x43, 0x00, 0x01, 0x00};
+    constexpr uint8_t set_mode[]         = {0x01, 0x44, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00, 0x00};
+    constexpr uint8_t set_mode_digital[] = {0x01, 0x44, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00};
+    constexpr uint8_t set_bytes_large[]  = {0x01, 0x4F, 0x00, 0xFF, 0xFF, 0x03, 0x00, 0x00, 0x00};
+    constexpr uint8_t set_bytes_small[]  = {0x01, 0x4F, 0x00, 0x3F, 0x00, 0x00, 0x00, 0x00, 0x00};    // buttons and sticks
+    constexpr uint8_t exit_config[]      = {0x01, 0x43, 0x00, 0x00, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A};
+    constexpr uint8_t enable_rumble[]    = {0x01, 0x4D, 0x00, 0x00, 0x01};
+    constexpr uint8_t type_read[]        = {0x01, 0x45, 0x00, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A};
+
+    // capability queries in config mode: 0x46 actuator / 0x4C mode info with the index in byte 3, 0x47
+    constexpr uint8_t read_actuator     = 0x46;
+    constexpr uint8_t read_combinations = 0x47;
+    constexpr uint8_t read_mode         = 0x4C;
+
+    // enter_config, set_mode, enable_rumble, set_bytes_large, exit_config
+    constexpr uint8_t RECONFIG_STEPS = 5;
+
+    // batched multitap read: header, then 8 bytes per port
+    constexpr uint8_t MULTITAP_FRAME = 3 + PS2XCore::MULTITAP_PORTS * 8;
+    constexpr uint8_t MULTITAP_ID    = 0x80;
+
+    // packet length announced by a mode id (low nibble = 16 bit words after
+    // the 3 byte header), 9 for anything that isn't a frame we can take
+    uint8_t frameLength(uint8_t mode)
+    {
+        uint8_t len = 3 + 2 * (mode & 0x0F);
+        return (len < 5 || len > 21) ? 9 : len;
+    }
+
+    // nobody drove DAT: no controller (or multitap) on this ATT line
+    bool noReply(const uint8_t* frame)
+    {
+        return frame[1] == 0xFF && frame[2] == 0xFF;
+    }
+
+    // large motor speed as sent: nothing below 0x40 makes it spin, so 1-255
+    // is spread over 0x40-0xFF (same as map(), in 16 bit math)
+    uint8_t motorSpeed(uint8_t motor2)
+    {
+        return (motor2 == 0) ? 0 : 0x40 + static_cast<uint16_t>(motor2) * 0xBF / 0xFF;
+    }
+
+    // calibrateTiming() search range and the margin kept from the limits found
+    constexpr uint32_t CALIBRATE_MAX_BITRATE    = 1'000'000UL;
+    constexpr uint16_t CALIBRATE_BYTE_MARGIN    = 2;    // uS
+    constexpr uint16_t CALIBRATE_PACKET_MARGIN  = 1;    // mS
+    constexpr uint8_t  CALIBRATE_BITRATE_MARGIN = 4;    // bitrate * 3 / 4
 }    // namespace
 
-bool PS2X::wasAnyToggled()
+inline void PS2XCore::BEGIN_SPI_NOATT()
+{
+    _transport->beginTransaction();
+}
+
+inline void PS2XCore::BEGIN_SPI()
+{
+    BEGIN_SPI_NOATT();
+    uint32_t elapsed = millis() - t_last_att;
+    if (elapsed < _packet_delay)
+        delay(_packet_delay - elapsed);
+    _transport->setAttention(true);    // low enable joystick
+    PS2X_STAT(_stat_t_att = micros());
+    delayMicroseconds(_transport->byteDelay());
+}
+
+inline void PS2XCore::END_SPI_NOATT()
+{
+    _transport->endTransaction();
+}
+
+inline void PS2XCore::END_SPI()
+{
+    END_SPI_NOATT();
+    _transport->setAttention(false);
+    t_last_att = millis();
+}
+
+bool PS2XCore::frameChanged() const
+{
+    return dirtyMask() != 0;
+}
+
+uint32_t PS2XCore::dirtyMask() const
+{
+    if (useSnapshot())
+        return snapshot().dirty;
+    return _dirty;
+}
+
+bool PS2XCore::changed(AnalogButton button) const
 {
+    return (dirtyMask() & (1UL << U16C(button))) != 0;
+}
+
+void PS2XCore::setChangeThreshold(AnalogButton button, uint8_t threshold)
+{
+    _change_threshold[U16C(button) - U16C(AnalogButton::Stick_Rx)] = threshold;
+}
+
+void PS2XCore::setChangeThreshold(uint8_t threshold)
+{
+    memset(_change_threshold, threshold, sizeof(_change_threshold));
+}
+
+bool PS2XCore::wasAnyToggled()
+{
+    if (useSnapshot())
+    {
+        Snapshot snap = snapshot();
+        return ((snap.last_buttons ^ snap.buttons) > 0);
+    }
     return ((last_buttons ^ buttons) > 0);
 }
 
-bool PS2X::wasToggled(Button button)
+bool PS2XCore::wasToggled(Button button)
 {
+    if (useSnapshot())
+        return snapshot().wasToggled(button);
     return ((last_buttons ^ buttons) & U16C(button)) > 0;
 }
 
-bool PS2X::wasPressed(Button button)
+bool PS2XCore::wasPressed(Button button)
 {
+    if (useSnapshot())
+        return snapshot().wasPressed(button);
     return wasToggled(button) && isPressed(button);
 }
 
-bool PS2X::wasReleased(Button button)
+bool PS2XCore::wasReleased(Button button)
 {
+    if (useSnapshot())
+        return snapshot().wasReleased(button);
     return wasToggled(button) && ((~last_buttons & U16C(button)) > 0);
 }
 
-bool PS2X::isPressed(Button button)
+bool PS2XCore::isPressed(Button button)
 {
+    if (useSnapshot())
+        return snapshot().isPressed(button);
     return (~buttons & U16C(button)) > 0;
 }
 
-uint16_t PS2X::ButtonDataByte()
+uint16_t PS2XCore::ButtonDataByte()
 {
+    if (useSnapshot())
+        return ~snapshot().buttons;
     return ~buttons;
 }
 
-uint8_t PS2X::analog(AnalogButton button)
+uint8_t PS2XCore::analog(AnalogButton button)
 {
+    if (useSnapshot())
+        return snapshot().analog(button);
     return PS2data[U16C(button)];
 }
 
-uint8_t PS2X::shiftInOut(char byte)
+void PS2XCore::attachRumble(PS2XRumble* rumble)
 {
-    if (_spi == NULL)
-    {
-        /* software SPI */
-        uint8_t tmp = 0;
+    _rumble = rumble;
+}
 
-        for (uint8_t i = 0; i < 8; i++)
-        {
-            if (CHK(byte, i))
-                CMD_SET();
-            else
-                CMD_CLR();
+PS2XRumble* PS2XCore::rumble() const
+{
+    return _rumble;
+}
 
-            CLK_CLR();
-            delayMicroseconds(CTRL_CLK);
+void PS2XCore::attachGestures(PS2XGestureEngine* gestures)
+{
+    _gestures = gestures;
+}
 
-            //if(DAT_CHK()) SET(tmp,i);
-            if (DAT_CHK())
-                bitSet(tmp, i);
+PS2XGestureEngine* PS2XCore::gestures() const
+{
+    return _gestures;
+}
 
-            CLK_SET();
-            delayMicroseconds(CTRL_CLK);
-        }
-        CMD_SET();
-        delayMicroseconds(CTRL_BYTE_DELAY);
-        return tmp;
-    }
-    else
-    {
-        uint8_t tmp = _spi->transfer(byte);    // hardware SPI
-        delayMicroseconds(CTRL_BYTE_DELAY);
-        return tmp;
-    }
+void PS2XCore::attachStick(Stick which, PS2XStick* pipeline)
+{
+    _sticks[U16C(which)] = pipeline;
+}
+
+PS2XStick* PS2XCore::stick(Stick which) const
+{
+    return _sticks[U16C(which)];
+}
+
+bool PS2XCore::Snapshot::isPressed(Button button) const
+{
+    return (~buttons & U16C(button)) > 0;
+}
+
+bool PS2XCore::Snapshot::wasToggled(Button button) const
+{
+    return ((last_buttons ^ buttons) & U16C(button)) > 0;
+}
+
+bool PS2XCore::Snapshot::wasPressed(Button button) const
+{
+    return wasToggled(button) && isPressed(button);
+}
+
+bool PS2XCore::Snapshot::wasReleased(Button button) const
+{
+    return wasToggled(button) && ((~last_buttons & U16C(button)) > 0);
+}
+
+uint8_t PS2XCore::Snapshot::analog(AnalogButton button) const
+{
+    return data[U16C(button)];
+}
+
+const PS2XCore::ControllerState& PS2XCore::state() const
+{
+    return _state;
+}
+
+PS2XCore::Snapshot PS2XCore::snapshot() const
+{
+    return _published.read();
+}
+
+bool PS2XCore::trySnapshot(Snapshot& snapshot) const
+{
+    return _published.tryRead(snapshot);
+}
+
+uint32_t PS2XCore::frameCount() const
+{
+    return _published.read().frame;
+}
+
+uint8_t PS2XCore::readEvents(ButtonEvent* events, uint8_t max)
+{
+    uint8_t count = 0;
+    while (count < max && _events.pop(events[count]))
+        count++;
+    return count;
 }
 
-bool PS2X::readGamepad(bool motor1, uint8_t motor2)
+bool PS2XCore::readEvent(ButtonEvent& event)
 {
+    return _events.pop(event);
+}
+
+uint8_t PS2XCore::eventsAvailable() const
+{
+    return _events.size();
+}
+
+uint32_t PS2XCore::eventOverflows() const
+{
+    return _events.overflows();
+}
+
+bool PS2XCore::readGamepad(bool motor1, uint8_t motor2)
+{
+    if (useSnapshot())
+        return snapshot().valid;    // the background task owns the bus
+
+    if (_connection != Connection::Connected && !reconnect())
+        return false;    // nothing there, probed again after the probe interval
+
+    if (_poll_reconfig == 0 && !frameDue(millis()))
+    {
+        // between scheduled frames: nothing new since the last call
+        last_buttons = buttons;
+        _dirty       = 0;
+        return !_stale && modeValid(PS2data[1]);
+    }
+
+    PS2X_STAT(uint32_t t_start = micros());
+    PS2X_STAT(_stats.polls++);
+
     double temp = millis() - last_read;
 
     if (temp > 1500)    //waited to long
-        reconfig_gamepad();
+    {
+        if (!_policy.fail_fast)
+            reconfig_gamepad();
+        else if (_poll_reconfig == 0)
+        {
+            _poll_reconfig = 1;    // spread over the next calls, see below
+            last_read      = millis();
+            PS2X_STAT(_stats.reconfigs++);
+        }
+    }
 
     if (temp < read_delay)    //waited too short
         delay(read_delay - temp);
 
-    if (motor2 != 0x00)
-        motor2 = map(motor2, 0, 255, 0x40, 0xFF);    //noting below 40 will make it spin
+    // fail fast: a pending reconfiguration costs one packet per call, the
+    // application keeps working with the last good frame meanwhile
+    if (_policy.fail_fast && reconfigStep())
+    {
+        last_buttons = buttons;
+        _dirty       = 0;
+        markStale();
+        return false;
+    }
+
+    if (_rumble != NULL)
+        _rumble->mix(millis(), motor1, motor2);
+    motor2 = motorSpeed(motor2);
 
-    uint8_t dword[9]   = {0x01, 0x42, 0, motor1, motor2, 0, 0, 0, 0};
-    uint8_t dword2[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    if (_multitap)
+    {
+        bool ok = readMultitap(motor1, motor2);
+        PS2X_STAT(recordFrameTime(micros() - t_start));
+        return ok;
+    }
+
+    // the full command frame; clock as much of it in one go as the last frame needed
+    uint8_t dword[21] = {0x01, 0x42, 0, motor1, motor2};
+    uint8_t len       = frameLength(PS2data[1]);
+    uint8_t attempts  = _policy.fail_fast ? 1 : _policy.attempts;
 
     // Try a few times to get valid data...
-    for (uint8_t RetryCnt = 0; RetryCnt < 5; RetryCnt++)
+    for (uint8_t RetryCnt = 0; RetryCnt < attempts; RetryCnt++)
     {
+        PS2X_STAT(if (RetryCnt != 0) _stats.retries++);
+
         BEGIN_SPI();
         //Send the command to send button and joystick data;
-        for (int i = 0; i < 9; i++)
-        {
-            PS2data[i] = shiftInOut(dword[i]);
-        }
+        _transport->transferPacket(dword, PS2data, len);
 
-        if (PS2data[1] == 0x79)
-        {    //if controller is in full data return mode, get the rest of data
-            for (int i = 0; i < 12; i++)
-            {
-                PS2data[i + 9] = shiftInOut(dword2[i]);
-            }
+        uint8_t needed = frameLength(PS2data[1]);
+        if (needed > len)
+        {    //controller returns more data than the last frame (e.g. full data return mode), get the rest of it
+            _transport->transferPacket(dword + len, PS2data + len, needed - len);
         }
 
         END_SPI();
 
         // Check to see if we received valid data or not.
         // We should be in analog mode for our data to be valid (analog == 0x7_)
-        if ((PS2data[1] & 0xf0) == 0x70)
+        if (modeValid(PS2data[1]))
             break;
 
+        // nobody answered, retrying and reconfiguring won't help
+        if (noReply(PS2data))
+        {
+            setConnection(Connection::Lost);
+            break;
+        }
+
         // If we got to here, we are not in analog mode, try to recover...
+        PS2X_STAT(_stats.mode_drops++);
+        if (_policy.fail_fast)
+        {
+            _poll_reconfig = 1;
+            PS2X_STAT(_stats.reconfigs++);
+            break;
+        }
+
         reconfig_gamepad();    // try to get back into Analog mode.
-        delay(read_delay);
+        if (RetryCnt + 1 < attempts)
+            delay(retryWait(RetryCnt + 1));
     }
 
-    // If we get here and still not in analog mode (=0x7_), try increasing the read_delay...
-    if ((PS2data[1] & 0xf0) != 0x70)
-    {
-        if (read_delay < 10)
-            read_delay++;    // see if this helps out...
-    }
+    bool ok = modeValid(PS2data[1]);
+    if (_connection == Connection::Connected)
+        frameResult(ok);    // If we get here and still not in analog mode (=0x7_), read_delay may grow...
 
 #ifdef PS2X_COM_DEBUG
     Serial.print("OUT:IN ");
-    for (int i = 0; i < 9; i++)
+    for (int i = 0; i < 21; i++)
     {
         Serial.print(dword[i], HEX);
         Serial.print(":");
         Serial.print(PS2data[i], HEX);
         Serial.print(" ");
     }
-    for (int i = 0; i < 12; i++)
-    {
-        Serial.print(dword2[i], HEX);
-        Serial.print(":");
-        Serial.print(PS2data[i + 9], HEX);
-        Serial.print(" ");
-    }
     Serial.println("");
 #endif
 
-    last_buttons = buttons;    //store the previous buttons states
+    if (!ok && _policy.fail_fast && _connection == Connection::Connected)
+    {
+        // keep the last good frame instead of the garbled one
+        memcpy(PS2data, _published.read().data, sizeof(PS2data));
+        last_buttons = buttons;    // no edges either, the frame didn't change
+        _dirty       = 0;
+        markStale();
+        PS2X_STAT(recordFrameTime(micros() - t_start));
+        return false;
+    }
 
-    buttons   = (uint16_t) (PS2data[4] << 8) + PS2data[3];    //store as one value for multiple functions
-    last_read = millis();
-    return ((PS2data[1] & 0xf0) == 0x70);    // 1 = OK = analog mode - 0 = NOK
+    processFrame();
+    if (ok)
+        setConnection(Connection::Connected);
+    PS2X_STAT(recordFrameTime(micros() - t_start));
+    return ok;    // 1 = OK = analog mode - 0 = NOK
 }
 
-uint8_t PS2X::begin(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures, bool rumble)
+bool PS2XCore::readMultitap(bool motor1, uint8_t motor2)
 {
-    _clk_pin = clk;
-    _cmd_pin = cmd;
-    _att_pin = att;
-    _dat_pin = dat;
+    uint8_t in[MULTITAP_FRAME]{};
+    bool    ok = false;
 
-    pinMode(clk, OUTPUT);    //configure ports
-    pinMode(att, OUTPUT);
-    ATT_SET();
-    pinMode(cmd, OUTPUT);
-    pinMode(dat, INPUT_PULLUP);    // enable pull-up
+    _port_motor1[0] = motor1;
+    _port_motor2[0] = motor2;
 
-    CLK_SET();
+    uint8_t attempts = _policy.fail_fast ? 1 : _policy.attempts;
+    for (uint8_t RetryCnt = 0; RetryCnt < attempts; RetryCnt++)
+    {
+        PS2X_STAT(if (RetryCnt != 0) _stats.retries++);
 
-    return config_gamepad_stub(pressures, rumble);
+        // a multitap that left batched mode is switched back by this very request
+        ok = transferMultitap(in);
+        if (ok || noReply(in))
+            break;
+        if (RetryCnt + 1 < attempts)
+            delay(retryWait(RetryCnt + 1));
+    }
+
+    if (noReply(in))
+    {
+        setConnection(Connection::Lost);
+        return false;
+    }
+
+    frameResult(ok);
+    if (!ok)
+    {
+        markStale();    // the port data of the last batched read stays
+        return false;
+    }
+
+    Multitap state = _multitap_state.read();
+    uint8_t  drops = 0;
+    for (uint8_t port = 0; port < MULTITAP_PORTS; port++)
+    {
+        const uint8_t* reply     = in + 3 + port * 8;
+        bool           connected = (reply[0] != 0xFF && reply[1] == 0x5A);
+
+        memcpy(state.data[port], reply, sizeof(state.data[port]));
+        state.last_buttons[port] = state.buttons[port];
+        state.buttons[port]      = connected ? (uint16_t) (reply[3] << 8) + reply[2] : 0xFFFF;
+
+        if (connected && !modeValid(reply[0]))
+            drops |= 1 << port;
+    }
+    _multitap_state.write(state);
+
+    // port A doubles as the single controller frame
+    memset(PS2data, 0, sizeof(PS2data));
+    PS2data[0] = in[0];
+    memcpy(PS2data + 1, in + 3, 8);
+    processFrame();
+    setConnection(Connection::Connected);
+
+    // controllers outside of analog mode (dropped out, or just plugged in)
+    for (uint8_t port = 0; port < MULTITAP_PORTS; port++)
+    {
+        if (CHK(drops, port))
+        {
+            PS2X_STAT(_stats.mode_drops++);
+            PS2X_STAT(_stats.reconfigs++);
+            reconfigPort(port);
+        }
+    }
+    return true;
 }
 
-#if defined(SPI_HAS_TRANSACTION)
-uint8_t PS2X::begin(SPIClass* spi, uint8_t att, bool pressures, bool rumble, bool begin)
+bool PS2XCore::transferMultitap(uint8_t* in)
 {
-    _spi     = spi;
-    _att_pin = att;
+    uint8_t out[MULTITAP_FRAME] = {0x01, 0x42, 0x01};    // 0x01: batched read of all ports
 
-    pinMode(att, OUTPUT);
-    ATT_SET();
+    // the command forwarded to each port
+    for (uint8_t port = 0; port < MULTITAP_PORTS; port++)
+    {
+        uint8_t* cmd = out + 3 + port * 8;
+        cmd[0]       = 0x42;
+        cmd[2]       = _port_motor1[port];
+        cmd[3]       = _port_motor2[port];
+    }
 
-    _spi_settings = SPISettings(CTRL_BITRATE, LSBFIRST, SPI_MODE3);
+    BEGIN_SPI();
+    _transport->transferPacket(out, in, sizeof(out));
+    END_SPI();
 
-    if (begin)
-        _spi->begin();    // begin SPI with default settings
+    return in[1] == MULTITAP_ID && in[2] == 0x5A;
+}
 
-    /* some hardware SPI implementations incorrectly hold CLK low before the first transaction, so we'll try to fix that */
-    BEGIN_SPI_NOATT();
-    _spi->transfer(0x55);    // anything will work here
-    END_SPI_NOATT();
+void PS2XCore::processFrame()
+{
+    // bytes the controller didn't send in its mode: sticks centered, nothing pressed
+    for (uint8_t i = frameLength(PS2data[1]); i < sizeof(PS2data); i++)
+        PS2data[i] = (i <= U16C(AnalogButton::Stick_Ly)) ? 0x80 : 0x00;
 
-    return config_gamepad_stub(pressures, rumble);
+    last_buttons = buttons;    //store the previous buttons states
+    _stale       = false;
+
+    buttons   = (uint16_t) (PS2data[4] << 8) + PS2data[3];    //store as one value for multiple functions
+    last_read = millis();
+
+    PS2X_STAT(_stats.latency.add(micros() - _stat_t_att));
+
+    // dirty bytes: moved beyond their threshold since they were last reported
+    _dirty = 0;
+    for (uint8_t i = 3; i < sizeof(PS2data); i++)
+    {
+        uint8_t delta     = (PS2data[i] > _reference[i]) ? PS2data[i] - _reference[i] : _reference[i] - PS2data[i];
+        uint8_t threshold = (i < U16C(AnalogButton::Stick_Rx)) ? 0 : _change_threshold[i - U16C(AnalogButton::Stick_Rx)];
+
+        if (delta > threshold || _report_all)
+        {
+            _dirty |= 1UL << i;
+            _reference[i] = PS2data[i];
+        }
+    }
+    _report_all = false;
+
+    if (_dirty != 0)
+        _t_activity = last_read;    // back to the active poll rate
+
+    if (_sticks[0] != NULL)
+        _sticks[0]->update(PS2data[U16C(AnalogButton::Stick_Lx)], PS2data[U16C(AnalogButton::Stick_Ly)], micros());
+    if (_sticks[1] != NULL)
+        _sticks[1]->update(PS2data[U16C(AnalogButton::Stick_Rx)], PS2data[U16C(AnalogButton::Stick_Ry)], micros());
+
+    _state.decode(PS2data);
+    if (_gestures != NULL)
+        _gestures->update(_state.pressed, last_read);
+
+    // publish for other tasks / cores
+    Snapshot snap;
+    snap.state = _state;
+    memcpy(snap.data, PS2data, sizeof(snap.data));
+    snap.buttons      = buttons;
+    snap.last_buttons = last_buttons;
+    snap.frame        = ++_frame;
+    snap.timestamp    = last_read;
+    snap.dirty        = _dirty;
+    snap.valid        = modeValid(PS2data[1]);
+    snap.stale        = false;
+    _published.write(snap);
+
+    // queue the edges, one event per changed button
+    uint16_t changed = last_buttons ^ buttons;
+    for (uint8_t i = 0; changed != 0; i++, changed >>= 1)
+    {
+        if (changed & 1)
+        {
+            ButtonEvent event;
+            event.button    = static_cast<Button>(1 << i);
+            event.pressed   = !CHK(buttons, i);
+            event.timestamp = last_read;
+            event.frame     = _frame;
+            _events.push(event);
+        }
+    }
 }
+
+bool PS2XCore::useSnapshot() const
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    // the task, or a call holding the bus against it, reads the members
+    return _task != NULL && xSemaphoreGetMutexHolder(_bus_lock) != xTaskGetCurrentTaskHandle();
+#else
+    return false;
 #endif
+}
 
-uint8_t PS2X::config_gamepad_stub(bool pressures, bool rumble)
+PS2XCore::BusLock::BusLock(const PS2XCore& core)
+#if defined(ARDUINO_ARCH_ESP32)
+    : _lock(core._bus_lock)
 {
-    uint8_t temp[sizeof(type_read)];
+    if (_lock != NULL)
+        xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+}
+#else
+{
+    (void) core;
+}
+#endif
 
+PS2XCore::BusLock::~BusLock()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_lock != NULL)
+        xSemaphoreGiveRecursive(_lock);
+#endif
+}
 
-    //new error checking. First, read gamepad a few times to see if it's talking
-    readGamepad();
-    readGamepad();
+bool PS2XCore::isPolling()
+{
+    return _poll_packet != NULL;
+}
 
-    //see if it talked - see if mode came back.
-    //If still anything but 41, 73 or 79, then it's not talking
-    if (PS2data[1] != 0x41 && PS2data[1] != 0x42 && PS2data[1] != 0x73 && PS2data[1] != 0x79)
+PS2XCore::PollStatus PS2XCore::poll(bool motor1, uint8_t motor2)
+{
+#ifdef PS2X_STATS
+    uint32_t   t_start = micros();
+    PollStatus status  = pollStep(motor1, motor2);
+
+    _stat_t_poll += micros() - t_start;
+    if (status != PollStatus::Busy)
     {
-#ifdef PS2X_DEBUG
-        Serial.println("Controller mode not matched or no controller found");
-        Serial.print("Expected 0x41, 0x42, 0x73 or 0x79, but got ");
-        Serial.println(PS2data[1], HEX);
-#endif
-        return 1;    //return error code 1
+        recordFrameTime(_stat_t_poll);
+        _stat_t_poll = 0;
     }
+    return status;
+#else
+    return pollStep(motor1, motor2);
+#endif
+}
 
-    //try setting mode, increasing delays if need be.
-    read_delay = 1;
+PS2XCore::PollStatus PS2XCore::pollStep(bool motor1, uint8_t motor2)
+{
+    if (_poll_packet == NULL)
+    {
+        /* idle: start the next packet once the bus is due */
+        uint32_t now = millis();
 
-    t_last_att = millis() + CTRL_PACKET_DELAY;    // start reading right away
+        // a single controller poll would get the batched header back and
+        // switch the multitap out of batched mode
+        if (_multitap)
+            return PollStatus::Error;
 
-    for (int y = 0; y <= 10; y++)
-    {
-        sendCommandString(enter_config, sizeof(enter_config));    //start config run
+        if (now - t_last_att < _packet_delay)
+            return PollStatus::Busy;
 
-        //read type
-        delayMicroseconds(CTRL_BYTE_DELAY);
+        if (_connection == Connection::Lost)
+        {
+            // the next frame doubles as presence probe
+            if (now - _t_probe < _probe_interval)
+                return PollStatus::Busy;
+            _t_probe = now;
+            setConnection(Connection::Probing);
+        }
 
-        //CLK_SET(); // CLK should've been set to HIGH already
-        BEGIN_SPI();
+        if (_poll_reconfig == 0 && _connection == Connection::Connected && now - last_read > 1500)
+        {
+            //waited to long, reconfigure first - the reconfiguration counts as a read so it isn't restarted
+            _poll_reconfig = 1;
+            last_read      = now;
+            PS2X_STAT(_stats.reconfigs++);
+        }
 
+        while (_poll_reconfig != 0 && _poll_packet == NULL)
+        {
+            _poll_size     = reconfigPacket(_poll_reconfig - 1, &_poll_packet);
+            _poll_reconfig = (_poll_reconfig < RECONFIG_STEPS) ? _poll_reconfig + 1 : 0;
+        }
 
-        for (int i = 0; i < 9; i++)
+        if (_poll_packet == NULL)
         {
-            temp[i] = shiftInOut(type_read[i]);
+            if (now - last_read < read_delay || !frameDue(now))    //waited too short
+                return PollStatus::Busy;
+
+            if (_rumble != NULL)
+                _rumble->mix(now, motor1, motor2);
+            motor2 = motorSpeed(motor2);
+
+            _poll_cmd[0] = 0x01;
+            _poll_cmd[1] = 0x42;
+            _poll_cmd[3] = motor1;
+            _poll_cmd[4] = motor2;
+            _poll_packet = _poll_cmd;
+            _poll_size   = sizeof(_poll_cmd);
+            PS2X_STAT(_stats.polls++);
         }
 
-        END_SPI();
+        _poll_len = _poll_size;
+        _poll_pos = 0;
+
+        BEGIN_SPI_NOATT();
+        _transport->setAttention(true);    // low enable joystick
+        _poll_t_byte = micros();
+        PS2X_STAT(_stat_t_att = _poll_t_byte);
+
+        // let the transport clock it in the background if it can, frames
+        // header first to learn their length
+        bool frame = (_poll_packet == _poll_cmd);
+        uint8_t len = frame ? 3 : _poll_len;
+        _poll_async = _transport->startPacket(_poll_packet, frame ? _poll_rx : NULL, len);
+        if (_poll_async)
+            _poll_pos = len;
+        return PollStatus::Busy;
+    }
 
+    bool frame = (_poll_packet == _poll_cmd);
 
-        controller_type = temp[3];
+    if (_poll_async)
+    {
+        /* background transfer in progress */
+        if (!_transport->packetDone())
+            return PollStatus::Busy;
 
-        sendCommandString(set_mode, sizeof(set_mode));
-        if (rumble)
+        if (frame && _poll_pos == 3)
         {
-            sendCommandString(enable_rumble, sizeof(enable_rumble));
-            en_Rumble = true;
+            _poll_len = frameLength(_poll_rx[1]);    //as many bytes as the controller announces
+            _poll_async = _transport->startPacket(_poll_cmd + 3, _poll_rx + 3, _poll_len - 3);
+            if (!_poll_async)
+                _poll_t_byte = micros();    // finish byte by byte
+            else
+                _poll_pos = _poll_len;
+            return PollStatus::Busy;
+        }
+        _poll_async = false;
+    }
+    else
+    {
+        /* transaction in progress: clock the next byte once the byte delay has passed */
+        if (micros() - _poll_t_byte < _transport->byteDelay())
+            return PollStatus::Busy;
+
+        uint8_t in = _transport->transfer((_poll_pos < _poll_size) ? _poll_packet[_poll_pos] : 0x00);
+        _poll_t_byte = micros();
+
+        if (frame)
+        {
+            _poll_rx[_poll_pos] = in;
+            if (_poll_pos == 1)
+                _poll_len = frameLength(in);    //as many bytes as the controller announces
+        }
+
+        if (++_poll_pos < _poll_len)
+            return PollStatus::Busy;
+    }
+
+    END_SPI();
+    _poll_packet = NULL;
+
+    if (!frame)
+        return PollStatus::Busy;
+
+    bool garbled = _policy.fail_fast && _connection == Connection::Connected && !modeValid(_poll_rx[1]) && !noReply(_poll_rx);
+    if (garbled)
+    {
+        // keep the last good frame instead of the garbled one, it still counts as a failed frame below
+        memcpy(PS2data, _published.read().data, sizeof(PS2data));
+        last_buttons = buttons;
+        _dirty       = 0;
+        markStale();
+    }
+    else
+    {
+        // the frame is complete, only now does it replace the current one
+        memcpy(PS2data, _poll_rx, sizeof(PS2data));
+        processFrame();
+    }
+
+    if (noReply(PS2data))
+    {
+        _poll_reconfig = 0;
+        _poll_failures = 0;
+        setConnection(Connection::Lost);
+        return PollStatus::Error;
+    }
+
+    if (_connection == Connection::Probing)
+    {
+        // back again: set it up before the next frame
+        setConnection(Connection::Reconfiguring);
+        _poll_reconfig = 1;
+        return PollStatus::Busy;
+    }
+
+    if (!garbled && modeValid(PS2data[1]))
+    {
+        _poll_failures = 0;
+        frameResult(true);
+        setConnection(Connection::Connected);
+        return PollStatus::Ready;
+    }
+
+    // not in analog mode: reconfigure before the next frame and, like readGamepad(),
+    // slow down after as many failed frames as it would have attempted
+    _poll_reconfig = 1;
+    PS2X_STAT(_stats.mode_drops++);
+    PS2X_STAT(_stats.reconfigs++);
+    if (++_poll_failures >= _policy.attempts)
+    {
+        _poll_failures = 0;
+        frameResult(false);
+    }
+    return PollStatus::Error;
+}
+
+uint8_t PS2XCore::begin(PS2XTransport& transport, bool pressures, bool rumble)
+{
+    _transport = &transport;
+    _transport->begin();
+
+    return config_gamepad_stub(pressures, rumble);
+}
+
+#if defined(ARDUINO)
+uint8_t PS2X::begin(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures, bool rumble)
+{
+    _software_spi = PS2XSoftwareSPI(clk, cmd, att, dat);
+    return begin(_software_spi, pressures, rumble);
+}
+
+PS2XSoftwareSPI& PS2X::softwareSPI()
+{
+    return _software_spi;
+}
+#endif
+
+#if defined(SPI_HAS_TRANSACTION)
+PS2XHardwareSPI& PS2X::hardwareSPI()
+{
+    return _hardware_spi;
+}
+#endif
+
+#if defined(SPI_HAS_TRANSACTION)
+uint8_t PS2X::begin(SPIClass* spi, uint8_t att, bool pressures, bool rumble, bool begin)
+{
+    _hardware_spi = PS2XHardwareSPI(spi, att, begin);
+    return PS2XCore::begin(_hardware_spi, pressures, rumble);
+}
+#endif
+
+uint8_t PS2XCore::config_gamepad_stub(bool pressures, bool rumble)
+{
+    uint8_t temp[sizeof(type_read)];
+
+    _connection = Connection::Connected;    // until the first packet says otherwise
+
+    _warm_started = _warm_slot != 0xFF && warmStart(pressures, rumble);
+    if (_warm_started)
+        return 0;
+
+    //new error checking. First, read gamepad a few times to see if it's talking
+    readGamepad();
+    readGamepad();
+
+    //see if it talked - see if mode came back.
+    //If still anything but 41, 73 or 79, then it's not talking
+    if (PS2data[1] != 0x41 && PS2data[1] != 0x42 && PS2data[1] != 0x73 && PS2data[1] != 0x79)
+    {
+#ifdef PS2X_DEBUG
+        Serial.println("Controller mode not matched or no controller found");
+        Serial.print("Expected 0x41, 0x42, 0x73 or 0x79, but got ");
+        Serial.println(PS2data[1], HEX);
+#endif
+        return 1;    //return error code 1
+    }
+
+    //try setting mode, increasing delays if need be.
+    read_delay = 1;
+
+    t_last_att = millis() + _packet_delay;    // start reading right away
+
+    for (int y = 0; y <= 10; y++)
+    {
+        sendCommandString(enter_config, sizeof(enter_config));    //start config run
+
+        //read type
+        delayMicroseconds(_transport->byteDelay());
+
+        //CLK_SET(); // CLK should've been set to HIGH already
+        BEGIN_SPI();
+
+        _transport->transferPacket(type_read, temp, sizeof(type_read));
+
+        END_SPI();
+
+
+        controller_type = temp[3];
+
+        sendCommandString(set_mode, sizeof(set_mode));
+        if (rumble)
+        {
+            sendCommandString(enable_rumble, sizeof(enable_rumble));
+            en_Rumble = true;
         }
         if (pressures)
         {
             sendCommandString(set_bytes_large, sizeof(set_bytes_large));
             en_Pressures = true;
+            _data_mode   = DataMode::Pressures;
         }
         sendCommandString(exit_config, sizeof(exit_config));
 
@@ -292,18 +919,107 @@ uint8_t PS2X::config_gamepad_stub(bool pressures, bool rumble)
         }
         read_delay += 1;    //add 1ms to read_delay
     }
+    _read_delay_min = read_delay;    // what the retry policy recovers back to
+
+    // what else the controller can tell about itself: once, now that it is
+    // configured, and only if no record of this controller is known yet
+    // (cached in the warm start slot or from loadCapabilities())
+    Capabilities cached = _caps;
+    if (_warm_slot != 0xFF && !ps2x_storage::load(ps2x_storage::Record::Capabilities, _warm_slot, &cached, sizeof(cached)))
+        cached.valid = false;
+
+    bool status_valid = temp[1] == 0xF3 && temp[2] == 0x5A;
+    if (cached.valid && status_valid && sameController(cached.status, temp + 3))
+    {
+        _caps            = cached;
+        _caps.read_delay = read_delay;
+    }
+    else
+        discoverCapabilities(temp + 3, status_valid);
+    _report_all = true;    // the application's first frame reports everything
+
+    // cache for the next warm start, flash is only written when it changed
+    if (_warm_slot != 0xFF && _caps.valid && memcmp(&cached, &_caps, sizeof(cached)) != 0)
+        saveCapabilities(_warm_slot);
     return 0;    //no error if here
 }
 
-void PS2X::sendCommandString(const uint8_t* string, uint8_t len)
+bool PS2XCore::sameController(const uint8_t* a, const uint8_t* b)
 {
-#ifdef PS2X_COM_DEBUG
-    uint8_t temp[len];
+    // byte 2 is the analog LED, it depends on the mode at the time of the query
+    return a[0] == b[0] && a[1] == b[1] && memcmp(a + 3, b + 3, 3) == 0;
+}
+
+void PS2XCore::discoverCapabilities(const uint8_t* status, bool status_valid)
+{
+    Capabilities caps;
+    memcpy(caps.status, status, sizeof(caps.status));
+    caps.valid = status_valid;
+
+    // the configuration set up by begin() survives entering and leaving config mode
+    sendCommandString(enter_config, sizeof(enter_config));
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        caps.valid &= queryCapability(read_actuator, i, caps.actuators[i]);
+        caps.valid &= queryCapability(read_mode, i, caps.modes[i]);
+    }
+    caps.valid &= queryCapability(read_combinations, 0, caps.combinations);
+    sendCommandString(exit_config, sizeof(exit_config));
+
+    caps.read_delay = read_delay;
+    _caps           = caps;
+}
+
+bool PS2XCore::warmStart(bool pressures, bool rumble)
+{
+    Capabilities cached;
+    if (!ps2x_storage::load(ps2x_storage::Record::Capabilities, _warm_slot, &cached, sizeof(cached)) || !cached.valid)
+        return false;
+
+    _caps           = cached;
+    controller_type = cached.status[0];
+    read_delay      = cached.read_delay;
+    if (rumble)
+        en_Rumble = true;
+    if (pressures)
+    {
+        en_Pressures = true;
+        _data_mode   = DataMode::Pressures;
+    }
+
+    // the known-good sequence once, then one frame must come back in the data mode
+    t_last_att = millis() + _packet_delay;    // start right away
+    reconfigPort(0);
+    if (!timingTrial(1))
+        return false;
+
+    last_read = millis();    // just configured, no need for the stale frame reconfiguration
+    readGamepad();
+
+    _read_delay_min = read_delay;
+    _report_all     = true;
+    return true;
+}
+
+bool PS2XCore::queryCapability(uint8_t command, uint8_t index, uint8_t* reply)
+{
+    uint8_t out[9] = {0x01, command, 0x00, index, 0x5A, 0x5A, 0x5A, 0x5A, 0x5A};
+    uint8_t in[9];
+
     BEGIN_SPI();
+    _transport->transferPacket(out, in, sizeof(out));
+    END_SPI();
 
-    for (int y = 0; y < len; y++)
-        temp[y] = shiftInOut(string[y]);
+    memcpy(reply, in + 3, 6);
+    return in[1] == 0xF3 && in[2] == 0x5A;
+}
 
+void PS2XCore::sendCommandString(const uint8_t* string, uint8_t len)
+{
+#ifdef PS2X_COM_DEBUG
+    uint8_t temp[len];
+    BEGIN_SPI();
+    _transport->transferPacket(string, temp, len);
     END_SPI();
 
     delay(read_delay);    //wait a few
@@ -319,18 +1035,21 @@ void PS2X::sendCommandString(const uint8_t* string, uint8_t len)
     Serial.println("");
 #else
     BEGIN_SPI();
-    for (int y = 0; y < len; y++)
-        shiftInOut(string[y]);
+    _transport->transferPacket(string, NULL, len);
     END_SPI();
 
     delay(read_delay);    //wait a few
 #endif
 }
 
-PS2X::Type PS2X::readType()
+PS2XCore::Type PS2XCore::readType()
 {
+    BusLock lock(*this);    // controller_type and PS2data[1] of the same configuration
+
+#ifdef PS2X_DEBUG
     Serial.print("Controller_type: ");
     Serial.println(controller_type, HEX);
+#endif
 
     if (controller_type == 0x03)
         return Type::DualShock;
@@ -344,39 +1063,436 @@ PS2X::Type PS2X::readType()
     return Type::Unknown;
 }
 
-void PS2X::enableRumble()
+void PS2XCore::enableRumble()
 {
+    BusLock lock(*this);
+
     sendCommandString(enter_config, sizeof(enter_config));
     sendCommandString(enable_rumble, sizeof(enable_rumble));
     sendCommandString(exit_config, sizeof(exit_config));
     en_Rumble = true;
 }
 
-bool PS2X::enablePressures()
+bool PS2XCore::enablePressures()
 {
-    sendCommandString(enter_config, sizeof(enter_config));
-    sendCommandString(set_bytes_large, sizeof(set_bytes_large));
-    sendCommandString(exit_config, sizeof(exit_config));
+    return setDataMode(DataMode::Pressures);
+}
+
+bool PS2XCore::setDataMode(DataMode mode)
+{
+    BusLock lock(*this);
+
+    if (mode == _data_mode)
+        return true;
+    if (mode == DataMode::Pressures && _multitap)
+        return false;    // batched multitap frames have no room for pressures
+
+    DataMode previous = _data_mode;
+    _data_mode        = mode;
+    en_Pressures      = (mode == DataMode::Pressures);
+    reconfig_gamepad();
 
     readGamepad();
     readGamepad();
 
-    if (PS2data[1] != 0x79)
+    if (mode != DataMode::Pressures || PS2data[1] == 0x79)
+        return true;
+
+    // no pressure sensitive buttons (e.g. a Guitar Hero controller)
+    _data_mode   = previous;
+    en_Pressures = false;
+    reconfig_gamepad();
+    return false;
+}
+
+PS2XCore::DataMode PS2XCore::dataMode() const
+{
+    return _data_mode;
+}
+
+void PS2XCore::setRetryPolicy(const RetryPolicy& policy)
+{
+    _policy = policy;
+    if (_policy.attempts == 0)
+        _policy.attempts = 1;
+}
+
+const PS2XCore::RetryPolicy& PS2XCore::retryPolicy() const
+{
+    return _policy;
+}
+
+bool PS2XCore::stale() const
+{
+    return _stale;
+}
+
+void PS2XCore::setPollSchedule(const PollSchedule& schedule)
+{
+    _schedule = schedule;
+
+    // the heartbeat must stay well below the 1.5 s after which a frame reconfigures
+    if (_schedule.idle_ms > 1000)
+        _schedule.idle_ms = 1000;
+    if (_schedule.idle_ms < _schedule.active_ms)
+        _schedule.idle_ms = _schedule.active_ms;
+}
+
+const PS2XCore::PollSchedule& PS2XCore::pollSchedule() const
+{
+    return _schedule;
+}
+
+uint16_t PS2XCore::pollInterval() const
+{
+    return scheduledInterval(millis());
+}
+
+uint16_t PS2XCore::scheduledInterval(uint32_t now) const
+{
+    if (_schedule.active_ms == 0)
+        return 0;
+
+    uint32_t quiet = now - _t_activity;
+    if (quiet < _schedule.idle_after)
+        return _schedule.active_ms;
+
+    quiet -= _schedule.idle_after;
+    if (quiet >= _schedule.ramp_ms)
+        return _schedule.idle_ms;
+    return _schedule.active_ms + static_cast<uint32_t>(_schedule.idle_ms - _schedule.active_ms) * quiet / _schedule.ramp_ms;
+}
+
+bool PS2XCore::frameDue(uint32_t now) const
+{
+    if (_schedule.active_ms == 0 || _multitap)
+        return true;
+#if defined(ARDUINO_ARCH_ESP32)
+    if (_task != NULL)
+        return true;    // the task sleeps for the interval itself
+#endif
+    return now - last_read >= scheduledInterval(now);
+}
+
+uint16_t PS2XCore::retryWait(uint8_t retry) const
+{
+    uint16_t wait = read_delay;
+
+    switch (_policy.backoff)
+    {
+        case Backoff::Fixed:
+            break;
+        case Backoff::Linear:
+            wait *= retry;
+            break;
+        case Backoff::Exponential:
+            wait <<= (retry < 8 ? retry - 1 : 7);
+            break;
+    }
+    return (wait > _policy.max_wait) ? _policy.max_wait : wait;
+}
+
+void PS2XCore::frameResult(bool ok)
+{
+    if (!ok)
+    {
+        _clean_frames = 0;
+        if (read_delay < _policy.max_read_delay)
+            read_delay++;    // see if this helps out...
+        return;
+    }
+
+    // step back down once things have been fine for a while
+    if (_policy.recover_frames == 0 || read_delay <= _read_delay_min)
+        return;
+    if (++_clean_frames >= _policy.recover_frames)
+    {
+        _clean_frames = 0;
+        read_delay--;
+    }
+}
+
+void PS2XCore::markStale()
+{
+    if (_stale)
+        return;
+
+    _stale = true;
+    _dirty = 0;    // nothing new to act on
+
+    Snapshot snap = _published.read();
+    snap.dirty    = 0;
+    snap.stale    = true;
+    _published.write(snap);
+}
+
+bool PS2XCore::reconfigStep()
+{
+    const uint8_t* packet = NULL;
+    uint8_t        len    = 0;
+
+    while (_poll_reconfig != 0 && packet == NULL)
+    {
+        len            = reconfigPacket(_poll_reconfig - 1, &packet);
+        _poll_reconfig = (_poll_reconfig < RECONFIG_STEPS) ? _poll_reconfig + 1 : 0;
+    }
+
+    if (packet == NULL)
         return false;
 
-    en_Pressures = true;
+    BEGIN_SPI();
+    _transport->transferPacket(packet, NULL, len);
+    END_SPI();
     return true;
 }
 
-void PS2X::reconfig_gamepad()
+PS2XCore::Connection PS2XCore::connection() const
 {
-    sendCommandString(enter_config, sizeof(enter_config));
-    sendCommandString(set_mode, sizeof(set_mode));
-    if (en_Rumble)
-        sendCommandString(enable_rumble, sizeof(enable_rumble));
-    if (en_Pressures)
-        sendCommandString(set_bytes_large, sizeof(set_bytes_large));
-    sendCommandString(exit_config, sizeof(exit_config));
+    return _connection;
+}
+
+bool PS2XCore::readConnectionEvent(ConnectionEvent& event)
+{
+    return _connection_events.pop(event);
+}
+
+void PS2XCore::setProbeInterval(uint16_t ms)
+{
+    _probe_interval = ms;
+}
+
+uint16_t PS2XCore::probeInterval() const
+{
+    return _probe_interval;
+}
+
+bool PS2XCore::reconnect()
+{
+    uint32_t now = millis();
+    if (now - _t_probe < _probe_interval)
+        return false;
+    _t_probe = now;
+
+    // one short poll, or a batched read that also puts a multitap back into batched mode
+    uint8_t in[MULTITAP_FRAME]{};
+    setConnection(Connection::Probing);
+    if (_multitap)
+        transferMultitap(in);
+    else
+    {
+        const uint8_t probe[5] = {0x01, 0x42};
+        BEGIN_SPI();
+        _transport->transferPacket(probe, in, sizeof(probe));
+        END_SPI();
+    }
+
+    if (noReply(in))
+    {
+        setConnection(Connection::Lost);
+        return false;
+    }
+
+    setConnection(Connection::Reconfiguring);
+    reconfig_gamepad();
+    last_read = millis();    // just configured, no need for the stale frame reconfiguration
+    setConnection(Connection::Connected);
+    return true;
+}
+
+void PS2XCore::setConnection(Connection state)
+{
+    if (state == _connection)
+        return;
+
+    Connection previous = _connection;
+    _connection         = state;
+
+    if (state == Connection::Lost)
+        _t_probe = millis();    // first probe one interval from now
+
+    // report losing and regaining the controller, not every failed probe
+    if (state == Connection::Connected || (state == Connection::Lost && previous == Connection::Connected))
+    {
+        ConnectionEvent event;
+        event.state     = state;
+        event.timestamp = millis();
+        _connection_events.push(event);
+    }
+}
+
+bool PS2XCore::modeValid(uint8_t mode) const
+{
+    // digital frames are a prefix of the analog ones, so an analog reply is fine too
+    if (_data_mode == DataMode::Digital && mode == 0x41)
+        return true;
+    return (mode & 0xf0) == 0x70;
+}
+
+void PS2XCore::reconfig_gamepad()
+{
+    BusLock lock(*this);
+
+    PS2X_STAT(_stats.reconfigs++);
+
+    if (!_multitap)
+    {
+        reconfigPort(0);
+        return;
+    }
+
+    Multitap state = _multitap_state.read();
+    for (uint8_t port = 0; port < MULTITAP_PORTS; port++)
+    {
+        if (state.data[port][0] != 0xFF)
+            reconfigPort(port);
+    }
+}
+
+void PS2XCore::reconfigPort(uint8_t port)
+{
+    const uint8_t* packet;
+    uint8_t        buf[9];
+
+    for (uint8_t step = 0; step < RECONFIG_STEPS; step++)
+    {
+        uint8_t len = reconfigPacket(step, &packet);
+        if (len == 0)
+            continue;
+
+        // the first byte addresses the controller, 0x01-0x04 = multitap port A-D
+        memcpy(buf, packet, len);
+        buf[0] = 0x01 + port;
+        sendCommandString(buf, len);
+    }
+}
+
+bool PS2XCore::enableMultitap()
+{
+    BusLock lock(*this);
+
+    uint8_t in[MULTITAP_FRAME]{};
+
+    // the first request switches a multitap to batched mode, the reply to the
+    // second one tells whether there is one
+    transferMultitap(in);
+    if (!transferMultitap(in))
+        return false;
+
+    Multitap state;
+    for (uint8_t port = 0; port < MULTITAP_PORTS; port++)
+    {
+        memcpy(state.data[port], in + 3 + port * 8, sizeof(state.data[port]));
+        state.buttons[port]      = 0xFFFF;
+        state.last_buttons[port] = 0xFFFF;
+    }
+    _multitap_state.write(state);
+
+    _multitap    = true;
+    en_Pressures = false;
+    if (_data_mode == DataMode::Pressures)
+        _data_mode = DataMode::Analog;
+    reconfig_gamepad();
+
+    readGamepad();
+    readGamepad();
+    return true;
+}
+
+bool PS2XCore::multitap() const
+{
+    return _multitap;
+}
+
+PS2XCore::Multitap PS2XCore::multitapState() const
+{
+    return _multitap_state.read();
+}
+
+bool PS2XCore::portConnected(uint8_t port) const
+{
+    return _multitap && port < MULTITAP_PORTS && _multitap_state.read().data[port][0] != 0xFF;
+}
+
+bool PS2XCore::isPressed(uint8_t port, Button button) const
+{
+    if (port >= MULTITAP_PORTS)
+        return false;
+    return (~_multitap_state.read().buttons[port] & U16C(button)) > 0;
+}
+
+bool PS2XCore::wasPressed(uint8_t port, Button button) const
+{
+    if (port >= MULTITAP_PORTS)
+        return false;
+
+    Multitap state = _multitap_state.read();
+    return ((state.last_buttons[port] ^ state.buttons[port]) & ~state.buttons[port] & U16C(button)) > 0;
+}
+
+bool PS2XCore::wasReleased(uint8_t port, Button button) const
+{
+    if (port >= MULTITAP_PORTS)
+        return false;
+
+    Multitap state = _multitap_state.read();
+    return ((state.last_buttons[port] ^ state.buttons[port]) & state.buttons[port] & U16C(button)) > 0;
+}
+
+uint8_t PS2XCore::analog(uint8_t port, AnalogButton button) const
+{
+    // batched frames end with the sticks, PS2data[5..8]
+    if (port >= MULTITAP_PORTS || U16C(button) > U16C(AnalogButton::Stick_Ly))
+        return 0;
+    return _multitap_state.read().data[port][U16C(button) - 1];
+}
+
+void PS2XCore::setPortMotors(uint8_t port, bool motor1, uint8_t motor2)
+{
+    if (port >= MULTITAP_PORTS)
+        return;
+
+    BusLock lock(*this);    // both values go out in the same batched read
+    motor2 = motorSpeed(motor2);
+
+    _port_motor1[port] = motor1;
+    _port_motor2[port] = motor2;
+}
+
+uint8_t PS2XCore::reconfigPacket(uint8_t step, const uint8_t** packet)
+{
+    *packet = NULL;
+
+    switch (step)
+    {
+        case 0:
+            *packet = enter_config;
+            return sizeof(enter_config);
+        case 1:
+            *packet = (_data_mode == DataMode::Digital) ? set_mode_digital : set_mode;
+            return sizeof(set_mode);
+        case 2:
+            if (!en_Rumble)
+                return 0;
+            *packet = enable_rumble;
+            return sizeof(enable_rumble);
+        case 3:
+            if (en_Pressures)
+            {
+                *packet = set_bytes_large;
+                return sizeof(set_bytes_large);
+            }
+            if (_data_mode == DataMode::Analog && controller_type == 0x03)
+            {
+                // a DualShock keeps its response bytes, drop pressures it may still send
+                *packet = set_bytes_small;
+                return sizeof(set_bytes_small);
+            }
+            return 0;
+        case 4:
+            *packet = exit_config;
+            return sizeof(exit_config);
+    }
+    return 0;
 }
 
 #if defined(SPI_HAS_TRANSACTION)
@@ -396,27 +1512,322 @@ uint8_t PS2X::begin_spi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool
 #        define VSPI FSPI
 #    endif
 
+SPIClass& PS2X::hostSPI(uint8_t host)
+{
+    // static storage, constructed on first use
+    static SPIClass hspi(HSPI);
+    static SPIClass vspi(VSPI);
+
+    return (host == VSPI) ? vspi : hspi;
+}
+
 uint8_t PS2X::begin_hspi(uint8_t att, bool pressures, bool rumble)
 {
-    return begin(new SPIClass(HSPI), att, pressures, rumble);
+    return begin(&hostSPI(HSPI), att, pressures, rumble);
 }
 
 uint8_t PS2X::begin_hspi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures, bool rumble)
 {
-    SPIClass* spi_class = new SPIClass(HSPI);
+    SPIClass* spi_class = &hostSPI(HSPI);
     spi_class->begin(clk, dat, cmd, att);
     return begin(spi_class, att, pressures, rumble, false);
 }
 
 uint8_t PS2X::begin_vspi(uint8_t att, bool pressures, bool rumble)
 {
-    return begin(new SPIClass(VSPI), att, pressures, rumble);
+    return begin(&hostSPI(VSPI), att, pressures, rumble);
 }
 
 uint8_t PS2X::begin_vspi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures, bool rumble)
 {
-    SPIClass* spi_class = new SPIClass(VSPI);
+    SPIClass* spi_class = &hostSPI(VSPI);
     spi_class->begin(clk, dat, cmd, att);
     return begin(spi_class, att, pressures, rumble, false);
 }
 #endif
+
+PS2XCore::TimingProfile PS2XCore::timingProfile() const
+{
+    TimingProfile profile;
+    profile.bitrate      = _transport->bitrate();
+    profile.byte_delay   = _transport->byteDelay();
+    profile.packet_delay = _packet_delay;
+    profile.read_delay   = read_delay;
+    return profile;
+}
+
+bool PS2XCore::applyTimingProfile(const TimingProfile& profile)
+{
+    BusLock lock(*this);    // not in the middle of the task's frame
+
+    bool ok = true;
+
+    if (profile.bitrate != 0 && profile.bitrate != _transport->bitrate())
+        ok &= _transport->setBitrate(profile.bitrate);
+    if (profile.byte_delay != _transport->byteDelay())
+        ok &= _transport->setByteDelay(profile.byte_delay);
+
+    _packet_delay   = (profile.packet_delay != 0) ? profile.packet_delay : 1;
+    read_delay      = profile.read_delay;
+    _read_delay_min = profile.read_delay;
+    return ok;
+}
+
+bool PS2XCore::timingTrial(uint8_t frames)
+{
+    uint8_t out[21] = {0x01, 0x42};
+    uint8_t in[21];
+    uint8_t len = frameLength(en_Pressures ? 0x79 : (_data_mode == DataMode::Digital ? 0x41 : 0x73));
+
+    for (uint8_t i = 0; i < frames; i++)
+    {
+        BEGIN_SPI();
+        _transport->transferPacket(out, in, len);
+        END_SPI();
+
+        // same check as readGamepad(), plus the 0x5A marker and the pressure mode if enabled
+        if (!modeValid(in[1]) || in[2] != 0x5A || (en_Pressures && in[1] != 0x79))
+            return false;
+    }
+    return true;
+}
+
+bool PS2XCore::calibrateTiming(uint8_t frames)
+{
+    BusLock lock(*this);
+
+    const TimingProfile initial = timingProfile();
+    TimingProfile       best    = initial;
+
+    if (!timingTrial(frames))
+        return false;    // not even working at the current timing
+
+    // apply a candidate and try it; on failure fall back to the best profile
+    // so far and bring the controller back into analog mode
+    auto works = [&](const TimingProfile& candidate) {
+        if (applyTimingProfile(candidate) && timingTrial(frames))
+            return true;
+
+        applyTimingProfile(best);
+        reconfig_gamepad();
+        return false;
+    };
+
+    // fastest clock (kHz steps), if the transport has one
+    if (best.bitrate != 0 && _transport->setBitrate(best.bitrate))
+    {
+        uint32_t lo = best.bitrate / 1000;
+        uint32_t hi = CALIBRATE_MAX_BITRATE / 1000;
+        while (lo < hi)
+        {
+            TimingProfile candidate = best;
+            uint32_t      mid       = (lo + hi + 1) / 2;
+            candidate.bitrate       = mid * 1000;
+            if (works(candidate))
+                lo = mid;
+            else
+                hi = mid - 1;
+        }
+        best.bitrate = lo * 1000;
+    }
+
+    // shortest byte delay, if it is adjustable
+    if (_transport->setByteDelay(best.byte_delay))
+    {
+        uint16_t lo = 0;
+        uint16_t hi = best.byte_delay;
+        while (lo < hi)
+        {
+            TimingProfile candidate = best;
+            uint16_t      mid       = (lo + hi) / 2;
+            candidate.byte_delay    = mid;
+            if (works(candidate))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        best.byte_delay = hi;
+    }
+
+    // shortest packet delay
+    {
+        uint16_t lo = 1;
+        uint16_t hi = best.packet_delay;
+        while (lo < hi)
+        {
+            TimingProfile candidate = best;
+            uint16_t      mid       = (lo + hi) / 2;
+            candidate.packet_delay  = mid;
+            if (works(candidate))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        best.packet_delay = hi;
+    }
+
+    // back off from the limits, but never beyond where we started
+    best.bitrate      = best.bitrate / CALIBRATE_BITRATE_MARGIN * 3;
+    best.byte_delay   = best.byte_delay + CALIBRATE_BYTE_MARGIN;
+    best.packet_delay = best.packet_delay + CALIBRATE_PACKET_MARGIN;
+    if (best.bitrate < initial.bitrate)
+        best.bitrate = initial.bitrate;
+    if (best.byte_delay > initial.byte_delay)
+        best.byte_delay = initial.byte_delay;
+    if (best.packet_delay > initial.packet_delay)
+        best.packet_delay = initial.packet_delay;
+
+    if (works(best))
+        return true;
+
+    // margin or not, the result doesn't hold up - keep what we had
+    applyTimingProfile(initial);
+    reconfig_gamepad();
+    return false;
+}
+
+bool PS2XCore::saveTimingProfile(uint8_t slot) const
+{
+    TimingProfile profile = timingProfile();
+    return ps2x_storage::save(ps2x_storage::Record::Timing, slot, &profile, sizeof(profile));
+}
+
+bool PS2XCore::loadTimingProfile(uint8_t slot)
+{
+    TimingProfile profile;
+    if (!ps2x_storage::load(ps2x_storage::Record::Timing, slot, &profile, sizeof(profile)))
+        return false;
+    return applyTimingProfile(profile);
+}
+
+const PS2XCore::Capabilities& PS2XCore::capabilities() const
+{
+    return _caps;
+}
+
+void PS2XCore::enableWarmStart(uint8_t slot)
+{
+    _warm_slot = slot;
+}
+
+bool PS2XCore::warmStarted() const
+{
+    return _warm_started;
+}
+
+static_assert(sizeof(PS2XCore::Capabilities) + 4 <= PS2X_STORAGE_RECORD_SIZE, "Capabilities don't fit a storage record");
+
+bool PS2XCore::saveCapabilities(uint8_t slot) const
+{
+    return _caps.valid && ps2x_storage::save(ps2x_storage::Record::Capabilities, slot, &_caps, sizeof(_caps));
+}
+
+bool PS2XCore::loadCapabilities(uint8_t slot)
+{
+    Capabilities caps;
+    if (!ps2x_storage::load(ps2x_storage::Record::Capabilities, slot, &caps, sizeof(caps)) || !caps.valid)
+        return false;
+    _caps = caps;
+    return true;
+}
+
+uint32_t PS2XCore::Timing::average() const
+{
+    return count != 0 ? static_cast<uint32_t>(total / count) : 0;
+}
+
+void PS2XCore::Timing::add(uint32_t us)
+{
+    if (count == 0 || us < min)
+        min = us;
+    if (us > max)
+        max = us;
+    total += us;
+    count++;
+}
+
+void PS2XCore::recordFrameTime(uint32_t us)
+{
+    _stats.frame_time.add(us);
+
+    uint8_t bucket = 0;
+    while (bucket < 7 && us >= (250UL << bucket))
+        bucket++;
+    _stats.histogram[bucket]++;
+}
+
+const PS2XCore::Stats& PS2XCore::stats()
+{
+    _stats.read_delay = read_delay;
+    return _stats;
+}
+
+void PS2XCore::resetStats()
+{
+    _stats = Stats{};
+}
+
+#if defined(ARDUINO_ARCH_ESP32)
+bool PS2XCore::startTask(uint16_t period_ms, BaseType_t core, UBaseType_t priority, uint32_t stack_size)
+{
+    if (_task != NULL || _transport == NULL)
+        return false;
+
+    _task_period = period_ms;
+    _task_stop   = false;
+    if (_bus_lock == NULL)
+        _bus_lock = xSemaphoreCreateRecursiveMutexStatic(&_bus_lock_buffer);
+
+    if (xTaskCreatePinnedToCore(taskEntry, "ps2x", stack_size, this, priority, &_task, core) != pdPASS)
+    {
+        _task = NULL;
+        return false;
+    }
+    return true;
+}
+
+void PS2XCore::stopTask()
+{
+    if (_task == NULL)
+        return;
+
+    _task_stop = true;
+    while (_task != NULL)    // the task clears the handle right before deleting itself
+        vTaskDelay(1);
+}
+
+bool PS2XCore::taskRunning() const
+{
+    return _task != NULL;
+}
+
+void PS2XCore::setTaskMotors(bool motor1, uint8_t motor2)
+{
+    _task_motor1 = motor1;
+    _task_motor2 = motor2;
+}
+
+void PS2XCore::taskEntry(void* arg)
+{
+    PS2XCore*  self = static_cast<PS2XCore*>(arg);
+    TickType_t wake = xTaskGetTickCount();
+
+    while (!self->_task_stop)
+    {
+        {
+            BusLock lock(*self);
+            self->readGamepad(self->_task_motor1, self->_task_motor2);
+        }
+
+        // the poll schedule stretches the period while the controller is idle
+        uint16_t   interval = self->pollInterval();
+        TickType_t period   = pdMS_TO_TICKS((interval > self->_task_period) ? interval : self->_task_period);
+        if (period == 0)
+            period = 1;
+        vTaskDelayUntil(&wake, period);
+    }
+
+    self->_task = NULL;
+    vTaskDelete(NULL);
+}
+#endif
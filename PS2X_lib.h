@@ -81,26 +81,73 @@ GNU General Public License for more details.
 
 #pragma once
 
-#include <Arduino.h>
-#include <SPI.h>
+// $$$$$$$$$$$$ CONFIGURATION SECTION $$$$$$$$$$$$$$$$
+// uncomment to collect bus statistics (see PS2XCore::stats()), compiled out
+// otherwise. Only the library's own code depends on it, the class layout is
+// the same either way.
+// #define PS2X_STATS
+
+// the event queue is part of PS2XCore's layout, a size set for the sketch
+// alone would silently disagree with the library build
+#ifdef PS2X_EVENT_QUEUE_SIZE
+#    error "PS2X_EVENT_QUEUE_SIZE is no longer configurable, see PS2XCore::EVENT_QUEUE_SIZE"
+#endif
 
+#include "PS2X_platform.h"
+#include "PS2X_rumble.h"
+#include "PS2X_state.h"
+#include "PS2X_stick.h"
+#include "PS2X_sync.h"
+#include "PS2X_transport.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#endif
 
-class PS2X
+class PS2XGestureEngine;
+
+
+// controller protocol on top of any PS2XTransport, see PS2X and PS2XStatic for
+// ready-made bus setups.
+//
+// The library does not use the heap: all state lives in the objects, bus
+// objects are static and buffers are fixed size (extras/test/alloc_test.cpp
+// checks the poll path). The exceptions are calls made once per use:
+//  - startTask() creates a FreeRTOS task
+//  - the non-volatile storage of save/loadTimingProfile() and
+//    save/loadCapabilities(), which begin() also uses for the warm start
+//    after enableWarmStart(): every access opens the NVS through
+//    Preferences on ESP32, the first EEPROM.begin() on ESP8266 allocates its
+//    RAM copy of the EEPROM area and keeps it
+class PS2XCore
 {
-    /* SPI timing configuration */
-    // SPI bitrate (Hz)
-    static constexpr uint32_t CTRL_BITRATE{250'000UL};
-
-    // delay duration between SCK high and low
-    static constexpr uint16_t CTRL_CLK{5};
+public:
+    // controller ports of a multitap
+    static constexpr uint8_t MULTITAP_PORTS{4};
+
+    // button press/release events buffered between two readEvents() calls
+#if defined(__AVR__)
+    static constexpr uint8_t EVENT_QUEUE_SIZE{8};
+#else
+    static constexpr uint8_t EVENT_QUEUE_SIZE{32};
+#endif
 
-    // delay duration between byte reads (uS)
-    static constexpr uint16_t CTRL_BYTE_DELAY{18};
+    // groups of dirtyMask() bits, bit n stands for frame byte n (as indexed by
+    // Button / AnalogButton: 3-4 digital buttons, 5-8 sticks, 9-20 pressures)
+    static constexpr uint32_t DIRTY_BUTTONS{0x0000'0018UL};
+    static constexpr uint32_t DIRTY_STICKS{0x0000'01E0UL};
+    static constexpr uint32_t DIRTY_PRESSURES{0x001F'FE00UL};
 
+protected:
+    /* bus timing configuration (bit and byte timing lives in the transports) */
     // delay duration between packets (mS) - according to playstation.txt this
     // should be set to 16mS, but it seems that it can go down to 4mS without
     // problems
     static constexpr uint16_t CTRL_PACKET_DELAY{16};
+    // interval between presence probes while no controller answers (mS)
+    static constexpr uint16_t CTRL_PROBE_INTERVAL{100};
 
 public:
     enum class Type
@@ -160,10 +207,280 @@ public:
         Square    = 16,
     };
 
-    Type readType();
+    enum class Stick
+    {
+        Left,
+        Right
+    };
+
+    // data the controller returns with every frame, see setDataMode()
+    enum class DataMode
+    {
+        Digital,     // buttons only (mode 0x41, 5 byte frames)
+        Analog,      // buttons and sticks (mode 0x73, 9 byte frames)
+        Pressures    // buttons, sticks and pressures (mode 0x79, 21 byte frames)
+    };
+
+    enum class Connection
+    {
+        Connected,        // controller answers
+        Lost,             // nothing answered the last packet, probed every probeInterval()
+        Probing,          // presence probe in progress
+        Reconfiguring     // controller answered a probe and is being set up again
+    };
+
+    struct ConnectionEvent
+    {
+        Connection state;
+        uint32_t   timestamp;    // millis() of the change
+    };
+
+    enum class PollStatus
+    {
+        Busy,     // transaction in progress or not due yet, call poll() again
+        Ready,    // a fresh frame has been decoded and the controller is in the requested data mode
+        Error     // a frame came back, but the controller dropped out of that mode or is gone
+    };
+
+    // a button changing state between two decoded frames
+    struct ButtonEvent
+    {
+        Button   button;
+        bool     pressed;      // false = released
+        uint32_t timestamp;    // millis() when the frame was decoded
+        uint32_t frame;        // frame counter, see frameCount()
+    };
+
+    // min / average / max of a duration (uS)
+    struct Timing
+    {
+        uint32_t min;
+        uint32_t max;
+        uint64_t total;
+        uint32_t count;
+
+        uint32_t average() const;
+        void     add(uint32_t us);
+    };
+
+    struct Stats
+    {
+        uint32_t polls;           // frames requested through readGamepad() / poll()
+        uint32_t retries;         // frames repeated by readGamepad() after an invalid reply
+        uint32_t reconfigs;       // reconfiguration sequences sent
+        uint32_t mode_drops;      // replies received outside of analog mode
+        uint8_t  read_delay;      // current read_delay (mS)
+        Timing   frame_time;      // time spent inside the library per frame
+        Timing   latency;         // ATT asserted to the last byte of the frame
+        uint32_t histogram[8];    // frame_time buckets: < 250uS, < 500uS, < 1mS, ... < 16mS, >= 16mS
+    };
+
+    // how the wait between readGamepad() attempts grows, starting at read_delay
+    enum class Backoff
+    {
+        Fixed,
+        Linear,
+        Exponential
+    };
+
+    // recovery from frames outside of the requested data mode, see setRetryPolicy()
+    struct RetryPolicy
+    {
+        uint8_t attempts;          // frames tried per readGamepad() call, reconfiguring after each bad one
+        Backoff backoff;           // wait between attempts
+        uint8_t max_wait;          // upper bound for that wait (mS)
+        uint8_t max_read_delay;    // read_delay grows by 1 mS per failed call up to this (mS)
+        uint8_t recover_frames;    // clean frames after which read_delay steps back down (0 = never)
+        bool    fail_fast;         // one packet per call, see setRetryPolicy()
+    };
+
+    // frame rate that follows the input, see setPollSchedule()
+    struct PollSchedule
+    {
+        uint16_t active_ms;     // frame interval while the input changes (0 = no schedule)
+        uint16_t idle_ms;       // heartbeat once idle, active_ms - 1000
+        uint16_t idle_after;    // time without a change before backing off (mS)
+        uint16_t ramp_ms;       // active_ms to idle_ms over this long (0 = step)
+    };
+
+    // bus timing, see calibrateTiming()
+    struct TimingProfile
+    {
+        uint32_t bitrate;         // SCK (Hz), 0 = transport without adjustable clock
+        uint16_t byte_delay;      // delay between bytes (uS)
+        uint16_t packet_delay;    // delay between packets (mS)
+        uint8_t  read_delay;      // minimum delay between frames (mS)
+    };
+
+    // what the controller answered in config mode during begin(), raw
+    // replies after the 0x5A marker, see capabilities()
+    struct Capabilities
+    {
+        uint8_t status[6];          // 0x45: type (0x03 DualShock, 0x01 Guitar Hero, ...), -, analog LED, ...
+        uint8_t actuators[2][6];    // 0x46 for actuator 0 / 1
+        uint8_t combinations[6];    // 0x47
+        uint8_t modes[2][6];        // 0x4C for mode 0 / 1 (byte 3: 0x04 digital, 0x07 analog)
+        uint8_t read_delay;         // read_delay the configuration took at (mS)
+        bool    valid;              // every query was answered in config mode
+    };
+
+    // decoded frame in logical order, see PS2X_state.h
+    using ControllerState = PS2XControllerState;
+
+    // consistent copy of one decoded frame, can be taken from any task or core
+    struct Snapshot
+    {
+        uint8_t         data[21];        // raw frame, as received
+        ControllerState state;           // the same frame decoded, see PS2XCore::state()
+        uint16_t        buttons;         // active low, as received
+        uint16_t        last_buttons;    // buttons of the frame before
+        uint32_t        frame;           // frame counter, 0 = nothing decoded yet
+        uint32_t        timestamp;       // millis() when the frame was decoded
+        uint32_t        dirty;           // see PS2XCore::dirtyMask()
+        bool            valid;           // controller was in the requested data mode
+        bool            stale;           // later frames failed, this is the last good one
+
+        bool    isPressed(Button button) const;
+        bool    wasToggled(Button button) const;
+        bool    wasPressed(Button button) const;
+        bool    wasReleased(Button button) const;
+        uint8_t analog(AnalogButton button) const;
+    };
+
+    // all ports of a multitap as of the last batched read
+    struct Multitap
+    {
+        uint8_t  data[MULTITAP_PORTS][8];       // per port: mode id (0xFF = empty), 0x5A, buttons, sticks
+        uint16_t buttons[MULTITAP_PORTS];       // active low, 0xFFFF for empty ports
+        uint16_t last_buttons[MULTITAP_PORTS];
+    };
+
+    Type                readType();
+    const Capabilities& capabilities() const;
 
     bool readGamepad(bool motor1 = false, uint8_t motor2 = 0);
 
+    // non-blocking alternative to readGamepad(): every call advances the bus
+    // transaction by at most one byte and returns immediately when the next
+    // packet/byte isn't due yet. Do not mix with readGamepad() while isPolling().
+    // Error without touching the bus while enableMultitap() is in effect.
+    PollStatus poll(bool motor1 = false, uint8_t motor2 = 0);
+    bool       isPolling();
+
+    // latest frame decoded once into buttons, sticks and pressures, to copy
+    // or loop over instead of calling analog() per value. The reference stays
+    // valid and is updated in place by the next frame; from another task or
+    // core use snapshot().state instead.
+    const ControllerState& state() const;
+
+    // latest decoded frame, lock-free and safe to call from any task or core.
+    // An ISR that may interrupt the polling code on the same core must use
+    // trySnapshot() instead, which fails rather than waiting for the frame
+    // being published.
+    Snapshot snapshot() const;
+    bool     trySnapshot(Snapshot& snapshot) const;
+    uint32_t frameCount() const;
+
+    // button edges of every decoded frame, oldest first. The decoder fills the
+    // queue and one consumer drains it (any task, core or ISR), so no press is
+    // lost or seen twice however the reads line up with the polls.
+    uint8_t  readEvents(ButtonEvent* events, uint8_t max);
+    bool     readEvent(ButtonEvent& event);
+    uint8_t  eventsAvailable() const;
+    uint32_t eventOverflows() const;    // events dropped because the queue was full
+
+    // replace the recovery strategy. The default {5, Fixed, 10, 10, 0, false}
+    // is the classic one: up to 5 attempts, each failure reconfigures and
+    // waits read_delay, which grows for good. With fail_fast a call never
+    // costs more than one packet: a bad frame is dropped (the accessors keep
+    // the last good one and stale() is set) and the reconfiguration is sent
+    // one packet per following call, e.g. {1, Fixed, 0, 10, 50, true}.
+    void               setRetryPolicy(const RetryPolicy& policy);
+    const RetryPolicy& retryPolicy() const;
+    bool               stale() const;
+
+    // activity-adaptive frame rate: while buttons or analog bytes change
+    // (dirtyMask(), so change thresholds filter stick noise) a frame is read
+    // every active_ms; after idle_after without a change the interval ramps
+    // up to the idle_ms heartbeat. The first changed frame snaps it back to
+    // active_ms, so only that first input waits for the slower interval.
+    // Between frames readGamepad() returns the last result without touching
+    // the bus (reporting no new edges), poll() returns Busy and the ESP32 task
+    // sleeps. E.g. {10, 100, 2000, 1000}; all 0 (the default) polls whenever
+    // asked. Not applied to multitap reads.
+    void                setPollSchedule(const PollSchedule& schedule);
+    const PollSchedule& pollSchedule() const;
+    uint16_t            pollInterval() const;    // interval in effect now (mS), 0 = no schedule
+
+    // connection tracking: while no controller answers, readGamepad() and
+    // poll() only send a short presence probe every probeInterval() and return
+    // right away otherwise. A controller that answers again is reconfigured
+    // with the current settings. Losing it and getting it back are queued as
+    // events (Lost / Connected).
+    Connection connection() const;
+    bool       readConnectionEvent(ConnectionEvent& event);
+    void       setProbeInterval(uint16_t ms);
+    uint16_t   probeInterval() const;
+
+    // current bus timing / switch to another one (false if the transport
+    // can't take it, e.g. PS2XStatic transports with fixed timing)
+    TimingProfile timingProfile() const;
+    bool          applyTimingProfile(const TimingProfile& profile);
+
+    // find the fastest bitrate, byte delay and packet delay at which every one
+    // of `frames` polls comes back in analog mode (binary search each, keeping
+    // the others at their best known value) and apply the result with a small
+    // safety margin. Blocks for a few seconds; call after a successful begin().
+    bool calibrateTiming(uint8_t frames = 20);
+
+    // persist the current timing / restore and apply a persisted one (NVS on
+    // ESP32, EEPROM on ESP8266 and AVR), slot selects one of several controllers
+    bool saveTimingProfile(uint8_t slot = 0) const;
+    bool loadTimingProfile(uint8_t slot = 0);
+
+    // warm start: begin() first replays the configuration with the read_delay
+    // and controller type cached in slot and checks it with one frame (a few
+    // packets instead of the full configuration); without a usable cache it
+    // configures the controller from scratch and caches the result, writing
+    // only when it changed. The capability queries run once after a
+    // successful configuration and are skipped when the cached record (or
+    // one from loadCapabilities()) has the same 0x45 reply. Call before
+    // begin(); a different controller model that still passes the warm
+    // check needs a cleared cache.
+    void enableWarmStart(uint8_t slot = 0);
+    bool warmStarted() const;    // the last begin() took the warm path
+    bool saveCapabilities(uint8_t slot = 0) const;
+    bool loadCapabilities(uint8_t slot = 0);
+
+    // bus health counters, all 0 unless the library is built with PS2X_STATS
+    const Stats& stats();
+    void         resetStats();
+
+#if defined(ARDUINO_ARCH_ESP32)
+    // poll the controller from a FreeRTOS task pinned to core, once every
+    // period_ms. While it runs, readGamepad() from other tasks doesn't touch
+    // the bus (it returns whether the latest frame was valid) and the button /
+    // analog accessors read the latest snapshot. Rumble is set with setTaskMotors().
+    // Calls that send packets themselves (setDataMode(), enableRumble(),
+    // reconfig_gamepad(), enableMultitap(), calibrateTiming(), ...) wait for
+    // the task's frame to finish and hold the bus until they are done.
+    bool startTask(uint16_t period_ms, BaseType_t core = 1, UBaseType_t priority = 2, uint32_t stack_size = 3072);
+    void stopTask();
+    bool taskRunning() const;
+    void setTaskMotors(bool motor1, uint8_t motor2);
+#endif
+
+    // change detection: which frame bytes moved since they were last reported
+    // as changed, beyond their threshold (0 = any change, the default). The
+    // first frame after begin() reports everything, frames dropped by the
+    // retry policy nothing. Skip the work for a frame when frameChanged() is
+    // false.
+    bool     frameChanged() const;
+    uint32_t dirtyMask() const;
+    bool     changed(AnalogButton button) const;
+    void     setChangeThreshold(AnalogButton button, uint8_t threshold);
+    void     setChangeThreshold(uint8_t threshold);    // all sticks and pressures
+
     bool isPressed(Button button);
 
     bool wasAnyToggled();
@@ -173,44 +490,62 @@ public:
 
     uint8_t analog(AnalogButton button);
 
-    void enableRumble();
-    bool enablePressures();
+    // run a stick pipeline (calibration, deadzone, curve, filter) on every
+    // decoded frame and read the result from it, NULL = off. The pipeline must
+    // outlive the PS2X object.
+    void       attachStick(Stick which, PS2XStick* pipeline);
+    PS2XStick* stick(Stick which) const;
 
-    // software SPI
-    uint8_t begin(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
-
-#if defined(SPI_HAS_TRANSACTION)
-    // explicit hardware SPI
-    uint8_t begin(SPIClass* spi, uint8_t att, bool pressures = false, bool rumble = false, bool begin = true);
-
-    // default hardware SPI
-    uint8_t begin_spi(uint8_t att, bool pressures = false, bool rumble = false);
-    // default hardware SPI with custom pins
-    uint8_t begin_spi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
+    void enableRumble();
 
-    // HSPI
-    uint8_t begin_hspi(uint8_t att, bool pressures = false, bool rumble = false);
-    // HSPI with custom pins
-    uint8_t begin_hspi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
-
-    // VSPI
-    uint8_t begin_vspi(uint8_t att, bool pressures = false, bool rumble = false);
-    // VSPI with custom pins
-    uint8_t begin_vspi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
-#endif
+    // play effects from a PS2XRumble (NULL = off): each frame sent gets the
+    // current mix of its effects, combined with the motor arguments of
+    // readGamepad() / poll(). Needs rumble enabled; the engine must outlive
+    // the PS2X object.
+    void        attachRumble(PS2XRumble* rumble);
+    PS2XRumble* rumble() const;
+
+    // run a chord / sequence recognizer (see PS2X_gesture.h) on every decoded
+    // frame, NULL = off. It must outlive the PS2X object.
+    void               attachGestures(PS2XGestureEngine* gestures);
+    PS2XGestureEngine* gestures() const;
+    bool enablePressures();    // same as setDataMode(DataMode::Pressures)
+
+    // reconfigure the controller to return only what the application needs
+    // right now, frames get only as long as that mode requires. false if the
+    // controller can't provide it (no pressures on a Guitar Hero controller or
+    // behind a multitap), the previous mode is kept then.
+    bool     setDataMode(DataMode mode);
+    DataMode dataMode() const;
+
+    // switch a multitap (SCPH-10090) on this ATT line to batched reads and
+    // put the controllers behind it into analog mode. readGamepad() then
+    // fetches all four ports in one packet; port 0 (A) also feeds the single
+    // controller accessors above, and readGamepad() returns whether the
+    // multitap answered. Batched frames carry no pressures, so those are
+    // turned off. poll() has no batched mode and returns Error while a
+    // multitap is enabled (so a PS2XBus can't interleave it either).
+    bool enableMultitap();
+    bool multitap() const;
+
+    // per port state of the last batched read, port 0-3 = A-D
+    Multitap multitapState() const;
+    bool     portConnected(uint8_t port) const;
+    bool     isPressed(uint8_t port, Button button) const;
+    bool     wasPressed(uint8_t port, Button button) const;
+    bool     wasReleased(uint8_t port, Button button) const;
+    uint8_t  analog(uint8_t port, AnalogButton button) const;    // sticks only
+
+    // rumble of ports B-D, port A uses readGamepad()'s arguments
+    void setPortMotors(uint8_t port, bool motor1, uint8_t motor2);
+
+    // any transport (e.g. PS2XSimController), must outlive the PS2X object
+    uint8_t begin(PS2XTransport& transport, bool pressures = false, bool rumble = false);
 
     uint16_t ButtonDataByte();
     void     reconfig_gamepad();
 
 private:
-    void CLK_SET();
-    void CLK_CLR();
-    void CMD_SET();
-    void CMD_CLR();
-    void ATT_SET();
-    void ATT_CLR();
-    bool DAT_CHK();
-
     void BEGIN_SPI_NOATT();
     void END_SPI_NOATT();
 
@@ -220,109 +555,260 @@ private:
     // common gamepad initialization sequence
     uint8_t config_gamepad_stub(bool pressures, bool rumble);
 
-    uint8_t shiftInOut(char byte);
+    // configuration from the cached capabilities, verified with one frame
+    bool warmStart(bool pressures, bool rumble);
+
+    // one capability query in config mode, false if it wasn't answered there
+    bool queryCapability(uint8_t command, uint8_t index, uint8_t* reply);
+
+    // full discovery after a successful configuration, status = 0x45 reply
+    void discoverCapabilities(const uint8_t* status, bool status_valid);
+
+    // 0x45 replies of the same controller model
+    static bool sameController(const uint8_t* a, const uint8_t* b);
+
     void    sendCommandString(const uint8_t* string, uint8_t len);
 
-    uint8_t  PS2data[21];
-    uint16_t last_buttons;
-    uint16_t buttons;
+    // packet of the reconfiguration sequence for a step (0 length = skipped step)
+    uint8_t reconfigPacket(uint8_t step, const uint8_t** packet);
 
-    // pin I/O configuration, mostly relevant to software SPI support (except ATT
-    // which is used in both software and hardware SPI)
-    int _clk_pin;
-    int _cmd_pin;
-    int _att_pin;
-    int _dat_pin;
+    // reconfiguration sequence addressed to one multitap port
+    void reconfigPort(uint8_t port);
 
-    // SPI configuration
-    SPIClass* _spi;    // hardware SPI class (null = software SPI)
-#if defined(SPI_HAS_TRANSACTION)
-    SPISettings _spi_settings;    // hardware SPI transaction settings
+    // readGamepad() with a multitap: one batched packet for all ports
+    bool readMultitap(bool motor1, uint8_t motor2);
+    bool transferMultitap(uint8_t* in);
+
+    // true if `frames` raw polls at the current timing all come back valid
+    bool timingTrial(uint8_t frames);
+
+    // poll() without the statistics bookkeeping
+    PollStatus pollStep(bool motor1, uint8_t motor2);
+
+    // latch the buttons of a freshly received PS2data frame
+    void processFrame();
+
+    // poll schedule: interval at now, whether a frame is due
+    uint16_t scheduledInterval(uint32_t now) const;
+    bool     frameDue(uint32_t now) const;
+
+    // mode id of a frame that matches the data mode
+    bool modeValid(uint8_t mode) const;
+
+    // retry policy: wait before a retry (1 = first one), bookkeeping after a
+    // readGamepad() call / poll() frame, keep the last good frame
+    uint16_t retryWait(uint8_t retry) const;
+    void     frameResult(bool ok);
+    void     markStale();
+
+    // send the next packet of a pending reconfiguration (_poll_reconfig), false if none
+    bool reconfigStep();
+
+    // probe for a lost controller once the probe interval has passed and set
+    // it up again if it answers, true if it is connected now
+    bool reconnect();
+    void setConnection(Connection state);
+
+    // true when accessors must read the published snapshot instead of the members
+    bool useSnapshot() const;
+
+    // holds the bus against the ESP32 polling task for its lifetime (the
+    // task holds it around each frame), no-op before the first startTask()
+    class BusLock
+    {
+    public:
+        explicit BusLock(const PS2XCore& core);
+        ~BusLock();
+
+        BusLock(const BusLock&)            = delete;
+        BusLock& operator=(const BusLock&) = delete;
+
+    private:
+#if defined(ARDUINO_ARCH_ESP32)
+        SemaphoreHandle_t _lock;
 #endif
+    };
 
-    uint32_t t_last_att;    // time since last ATT inactive
+#if defined(ARDUINO_ARCH_ESP32)
+    static void taskEntry(void* arg);
+#endif
 
-    uint32_t last_read;
-    uint8_t  read_delay;
-    uint8_t  controller_type;
-    bool     en_Rumble;
-    bool     en_Pressures;
+    uint8_t  PS2data[21]{};
+    uint16_t last_buttons{0xFFFF};
+    uint16_t buttons{0xFFFF};
+
+    ControllerState       _state{};     // PS2data decoded by processFrame()
+    uint32_t              _frame{0};    // number of frames decoded
+    PS2XSeqLock<Snapshot> _published;   // latest frame for other tasks / cores
+
+    PS2XRing<ButtonEvent, EVENT_QUEUE_SIZE> _events;
+
+    // change detection
+    uint32_t _dirty{0};
+    uint8_t  _reference[21]{};           // frame bytes as last reported dirty
+    uint8_t  _change_threshold[16]{};    // per analog byte (PS2data[5..20])
+    bool     _report_all{true};          // next frame is dirty as a whole
+
+    PS2XStick*         _sticks[2]{};       // pipelines fed by processFrame(), see attachStick()
+    PS2XRumble*        _rumble{NULL};      // effects mixed into each frame sent
+    PS2XGestureEngine* _gestures{NULL};    // recognizer fed by processFrame()
+
+    // bus access
+    PS2XTransport* _transport{NULL};
+
+    uint32_t t_last_att{0};    // time since last ATT inactive
+
+    uint32_t last_read{0};
+    uint8_t  read_delay{0};
+    uint8_t  controller_type{0};
+    bool     en_Rumble{false};
+    bool     en_Pressures{false};
+    DataMode _data_mode{DataMode::Analog};
+
+    // capability discovery / warm start
+    Capabilities _caps{};
+    uint8_t      _warm_slot{0xFF};    // cache slot, 0xFF = no warm start
+    bool         _warm_started{false};
+
+    // retry policy
+    RetryPolicy _policy{5, Backoff::Fixed, 10, 10, 0, false};
+    uint8_t     _read_delay_min{0};    // read_delay after begin(), where recovery stops
+    uint8_t     _clean_frames{0};      // valid frames since read_delay last changed
+    bool        _stale{false};
+
+    // poll schedule
+    PollSchedule _schedule{0, 0, 0, 0};
+    uint32_t     _t_activity{0};    // millis() of the last frame with a change
+
+    // connection tracking
+    Connection                   _connection{Connection::Connected};
+    uint16_t                     _probe_interval{CTRL_PROBE_INTERVAL};
+    uint32_t                     _t_probe{0};    // millis() of the last presence probe
+    PS2XRing<ConnectionEvent, 4> _connection_events;
+
+    // multitap
+    bool                  _multitap{false};
+    bool                  _port_motor1[MULTITAP_PORTS]{};
+    uint8_t               _port_motor2[MULTITAP_PORTS]{};
+    PS2XSeqLock<Multitap> _multitap_state;    // last batched read, for any task / core
+
+    // poll() state machine
+    const uint8_t* _poll_packet{NULL};    // packet being clocked out (null = idle)
+    uint8_t        _poll_cmd[21]{};       // poll command of the current frame, padded for startPacket()
+    uint8_t        _poll_rx[21]{};        // frame being received, PS2data keeps the last one until it is complete
+    uint8_t        _poll_size{0};         // size of _poll_packet, further bytes are sent as 0x00
+    uint8_t        _poll_len{0};          // number of bytes to clock in this transaction
+    uint8_t        _poll_pos{0};          // index of the next byte to clock
+    bool           _poll_async{false};    // packet handed to _transport->startPacket()
+    uint8_t        _poll_reconfig{0};     // next reconfiguration step + 1 (0 = none pending)
+    uint8_t        _poll_failures{0};     // consecutive frames not in analog mode
+    uint32_t       _poll_t_byte{0};       // time of the last bus event (uS)
+
+    // statistics, only updated with PS2X_STATS
+    Stats    _stats{};
+    uint32_t _stat_t_att{0};      // micros() when ATT was last asserted
+    uint32_t _stat_t_poll{0};     // time spent in poll() for the current frame (uS)
+
+    void recordFrameTime(uint32_t us);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    // background polling task
+    TaskHandle_t     _task{NULL};
+    uint16_t         _task_period{0};
+    volatile bool    _task_stop{false};
+    volatile bool    _task_motor1{false};
+    volatile uint8_t _task_motor2{0};
+    SemaphoreHandle_t _bus_lock{NULL};    // recursive, see BusLock
+    StaticSemaphore_t _bus_lock_buffer;
+#endif
+
+protected:
+    uint16_t _packet_delay{CTRL_PACKET_DELAY};    // delay duration between packets (mS)
 };
 
 
-inline void PS2X::CLK_SET()
+// runtime configured controller: software SPI on any pins or a hardware SPI bus
+class PS2X : public PS2XCore
 {
-    digitalWrite(_clk_pin, HIGH);
-}
+public:
+    using PS2XCore::begin;
 
-inline void PS2X::CLK_CLR()
-{
-    digitalWrite(_clk_pin, LOW);
-}
+#if defined(ARDUINO)
+    // software SPI
+    uint8_t begin(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
+#endif
 
-inline void PS2X::CMD_SET()
-{
-    digitalWrite(_cmd_pin, HIGH);
-}
+#if defined(SPI_HAS_TRANSACTION)
+    // explicit hardware SPI
+    uint8_t begin(SPIClass* spi, uint8_t att, bool pressures = false, bool rumble = false, bool begin = true);
 
-inline void PS2X::CMD_CLR()
-{
-    digitalWrite(_cmd_pin, LOW);
-}
+    // default hardware SPI
+    uint8_t begin_spi(uint8_t att, bool pressures = false, bool rumble = false);
+    // default hardware SPI with custom pins
+    uint8_t begin_spi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
 
-inline void PS2X::ATT_SET()
-{
-    digitalWrite(_att_pin, HIGH);
-}
+    // bus object of an SPI host (HSPI / VSPI), static and shared by every
+    // PS2X on that host, so re-running begin_hspi() / begin_vspi() (hot-plug,
+    // mode switches) allocates nothing. Other buses: pass your own SPIClass.
+    static SPIClass& hostSPI(uint8_t host);
 
-inline void PS2X::ATT_CLR()
-{
-    digitalWrite(_att_pin, LOW);
-}
+    // HSPI
+    uint8_t begin_hspi(uint8_t att, bool pressures = false, bool rumble = false);
+    // HSPI with custom pins
+    uint8_t begin_hspi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
 
-inline bool PS2X::DAT_CHK()
-{
-    return digitalRead(_dat_pin) ? true : false;
-}
+    // VSPI
+    uint8_t begin_vspi(uint8_t att, bool pressures = false, bool rumble = false);
+    // VSPI with custom pins
+    uint8_t begin_vspi(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat, bool pressures = false, bool rumble = false);
+#endif
+
+#if defined(ARDUINO)
+    // transport behind the pin based begin(), e.g. to tune its clock
+    PS2XSoftwareSPI& softwareSPI();
+#endif
+#if defined(SPI_HAS_TRANSACTION)
+    // transport behind the SPIClass based begin*(), e.g. to enable bulk transfers
+    PS2XHardwareSPI& hardwareSPI();
+#endif
 
-inline void PS2X::BEGIN_SPI_NOATT()
+private:
+#if defined(ARDUINO)
+    PS2XSoftwareSPI _software_spi;    // used by the pin based begin()
+#endif
+#if defined(SPI_HAS_TRANSACTION)
+    PS2XHardwareSPI _hardware_spi;    // used by the SPIClass based begin*()
+#endif
+};
+
+
+// controller with the transport fixed at compile time, e.g.
+//     PS2XStatic<PS2XStaticSoftwareSPI<CLK, CMD, ATT, DAT>> ps2x;
+//     ps2x.begin(pressures, rumble);
+// only the code of that one transport ends up in the binary and its bit loop
+// is inlined with constant pins and delays
+template <class Transport, uint16_t PacketDelay = 16>
+class PS2XStatic : public PS2XCore
 {
-    if (_spi != NULL)
-    {
-        _spi->beginTransaction(_spi_settings);
-    }
-    else
+public:
+    using PS2XCore::begin;
+
+    PS2XStatic()
     {
-        CMD_SET();
-        CLK_SET();
+        _packet_delay = PacketDelay;
     }
-}
 
-inline void PS2X::BEGIN_SPI()
-{
-    BEGIN_SPI_NOATT();
-    while (millis() - t_last_att < CTRL_PACKET_DELAY)
-        ;
-    ATT_CLR();    // low enable joystick
-    delayMicroseconds(CTRL_BYTE_DELAY);
-}
-
-inline void PS2X::END_SPI_NOATT()
-{
-    if (_spi != NULL)
+    uint8_t begin(bool pressures = false, bool rumble = false)
     {
-        _spi->endTransaction();
+        return PS2XCore::begin(_bus, pressures, rumble);
     }
-    else
+
+    Transport& transport()
     {
-        CMD_SET();
-        CLK_SET();
+        return _bus;
     }
-}
 
-inline void PS2X::END_SPI()
-{
-    END_SPI_NOATT();
-    ATT_SET();
-    t_last_att = millis();
-}
+private:
+    Transport _bus;
+};
+
@@ -0,0 +1,73 @@
+#include "PS2X_platform.h"
+
+#if !defined(ARDUINO)
+
+#include <chrono>
+#include <thread>
+
+namespace
+{
+    bool     virtual_clock = false;
+    uint64_t virtual_us    = 0;
+
+    uint64_t host_us()
+    {
+        static const auto start = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+}    // namespace
+
+void ps2x_host::useVirtualClock(bool enable)
+{
+    virtual_clock = enable;
+}
+
+void ps2x_host::advanceClock(uint32_t us)
+{
+    virtual_us += us;
+}
+
+void ps2x_host::setClock(uint32_t us)
+{
+    if (virtual_clock)
+        virtual_us = us;
+}
+
+unsigned long micros()
+{
+    return static_cast<unsigned long>(virtual_clock ? virtual_us : host_us()) & 0xFFFFFFFFUL;
+}
+
+unsigned long millis()
+{
+    return static_cast<unsigned long>((virtual_clock ? virtual_us : host_us()) / 1000) & 0xFFFFFFFFUL;
+}
+
+void delay(unsigned long ms)
+{
+    if (virtual_clock)
+        virtual_us += static_cast<uint64_t>(ms) * 1000;
+    else
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    if (virtual_clock)
+    {
+        virtual_us += us;
+        return;
+    }
+
+    // busy-wait like the Arduino core does, sleeping is far too coarse
+    uint64_t start = host_us();
+    while (host_us() - start < us)
+        ;
+}
+
+long map(long x, long in_min, long in_max, long out_min, long out_max)
+{
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+/*
+ * Platform glue: on Arduino this is just the core header. Everywhere else
+ * (e.g. a Linux host building the library against PS2XSimController) a
+ * minimal subset of the Arduino core API is provided by PS2X_platform.cpp.
+ */
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+
+unsigned long millis();
+unsigned long micros();
+void          delay(unsigned long ms);
+void          delayMicroseconds(unsigned int us);
+long          map(long x, long in_min, long in_max, long out_min, long out_max);
+
+namespace ps2x_host
+{
+    // with the virtual clock enabled, millis()/micros() only move when
+    // delay()/delayMicroseconds()/advanceClock() are called, so simulated
+    // bus timing runs as fast as the host can execute it
+    void useVirtualClock(bool enable);
+    void advanceClock(uint32_t us);
+    // jump the virtual clock to micros() = us, no-op on the real clock
+    void setClock(uint32_t us);
+}    // namespace ps2x_host
+
+#endif
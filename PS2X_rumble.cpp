@@ -0,0 +1,148 @@
+#include "PS2X_rumble.h"
+
+namespace
+{
+    // handle = generation (1-31) << 3 | slot
+    constexpr uint8_t SLOT_BITS = 3;
+    constexpr uint8_t SLOT_MASK = (1 << SLOT_BITS) - 1;
+}    // namespace
+
+PS2XRumble::Effect PS2XRumble::pulse(Motor motor, uint8_t level, uint16_t ms, uint8_t priority)
+{
+    return Effect{motor, level, 0, ms, 0, 0, 0, priority};
+}
+
+PS2XRumble::Effect PS2XRumble::pulses(Motor motor, uint8_t level, uint16_t on_ms, uint16_t off_ms, uint8_t count, uint8_t priority)
+{
+    return Effect{motor, level, 0, on_ms, 0, off_ms, static_cast<uint8_t>((count > 0) ? count - 1 : 0), priority};
+}
+
+PS2XRumble::Effect PS2XRumble::ramp(Motor motor, uint8_t from_zero_to, uint16_t ms, uint8_t priority)
+{
+    return Effect{motor, from_zero_to, ms, 0, 0, 0, 0, priority};
+}
+
+PS2XRumble::Handle PS2XRumble::play(const Effect& effect)
+{
+    // a free slot, else the lowest priority one below the new effect
+    int8_t slot = -1;
+    for (uint8_t i = 0; i < PS2X_RUMBLE_SLOTS; i++)
+    {
+        if (_slots[i].handle == 0)
+        {
+            slot = i;
+            break;
+        }
+        if (_slots[i].effect.priority < effect.priority && (slot < 0 || _slots[i].effect.priority < _slots[slot].effect.priority))
+            slot = i;
+    }
+    if (slot < 0)
+        return 0;
+
+    _generation = (_generation >= 31) ? 1 : _generation + 1;
+
+    Slot& s  = _slots[slot];
+    s.effect = effect;
+    s.start  = millis();
+    s.handle = (_generation << SLOT_BITS) | slot;
+    s.sent   = false;
+    return s.handle;
+}
+
+void PS2XRumble::stop(Handle handle)
+{
+    if (handle != 0 && (handle & SLOT_MASK) < PS2X_RUMBLE_SLOTS && _slots[handle & SLOT_MASK].handle == handle)
+        _slots[handle & SLOT_MASK].handle = 0;
+}
+
+void PS2XRumble::stopAll()
+{
+    for (Slot& slot : _slots)
+        slot.handle = 0;
+}
+
+bool PS2XRumble::playing(Handle handle) const
+{
+    return handle != 0 && (handle & SLOT_MASK) < PS2X_RUMBLE_SLOTS && _slots[handle & SLOT_MASK].handle == handle;
+}
+
+bool PS2XRumble::active() const
+{
+    for (const Slot& slot : _slots)
+    {
+        if (slot.handle != 0)
+            return true;
+    }
+    return false;
+}
+
+void PS2XRumble::mix(uint32_t now, bool& motor1, uint8_t& motor2)
+{
+    // per motor (0 = small, 1 = large): winning priority and level
+    bool    any[2]  = {false, false};
+    uint8_t best[2] = {0, 0};
+    uint8_t out[2]  = {0, 0};
+
+    for (Slot& slot : _slots)
+    {
+        uint8_t value;
+        if (slot.handle == 0)
+            continue;
+        if (!level(slot, now, value))
+        {
+            slot.handle = 0;    // over
+            continue;
+        }
+        if (value == 0)
+            continue;
+        slot.sent = true;
+
+        const Effect& effect = slot.effect;
+        for (uint8_t m = 0; m < 2; m++)
+        {
+            if (effect.motor != Motor::Both && static_cast<uint8_t>(effect.motor) != m)
+                continue;
+
+            uint8_t v = (m == 0) ? ((value * 2 >= effect.level) ? 0xFF : 0) : value;
+            if (!any[m] || effect.priority > best[m])
+            {
+                any[m]  = true;
+                best[m] = effect.priority;
+                out[m]  = v;
+            }
+            else if (effect.priority == best[m] && v > out[m])
+                out[m] = v;
+        }
+    }
+
+    motor1 = motor1 || out[0] != 0;
+    if (out[1] > motor2)
+        motor2 = out[1];
+}
+
+bool PS2XRumble::level(Slot& slot, uint32_t now, uint8_t& value)
+{
+    const Effect& effect = slot.effect;
+    uint32_t      shape  = static_cast<uint32_t>(effect.attack) + effect.hold + effect.release;
+    uint32_t      cycle  = shape + effect.gap;
+    uint32_t      t      = now - slot.start;
+    uint32_t      n      = (cycle == 0) ? 0 : t / cycle;
+    uint32_t      phase  = (cycle == 0) ? t : t % cycle;
+
+    if (effect.repeat != FOREVER && (n > effect.repeat || (n == effect.repeat && phase >= shape)))
+    {
+        // over - unless it fell between two frames, then it gets one at its peak
+        value = effect.level;
+        return !slot.sent;
+    }
+
+    if (phase < effect.attack)
+        value = static_cast<uint32_t>(effect.level) * phase / effect.attack;
+    else if (phase < static_cast<uint32_t>(effect.attack) + effect.hold)
+        value = effect.level;
+    else if (phase < shape)
+        value = static_cast<uint32_t>(effect.level) * (shape - phase) / effect.release;
+    else
+        value = 0;    // gap
+    return true;
+}
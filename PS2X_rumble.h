@@ -0,0 +1,84 @@
+#pragma once
+
+#include "PS2X_platform.h"
+
+// effects that can play at the same time
+#ifndef PS2X_RUMBLE_SLOTS
+#    define PS2X_RUMBLE_SLOTS 4
+#endif
+
+/*
+ * Rumble effect player. Effects are started with play() and run on their
+ * own; attached to a controller (PS2XCore::attachRumble()) the engine is
+ * asked for the motor values right when each frame is sent, so envelopes
+ * follow the clock instead of the poll rate and the sketch never waits.
+ *
+ * Every effect is an envelope - ramp up over attack, hold, ramp down over
+ * release - optionally repeated after a gap. On each motor the active effects
+ * of the highest priority win, the strongest of those sets the level. An
+ * effect shorter than the frame interval still gets one frame at its peak.
+ *
+ * Not locked: call play()/stop() from the task that reads the controller.
+ */
+class PS2XRumble
+{
+    static_assert(PS2X_RUMBLE_SLOTS > 0 && PS2X_RUMBLE_SLOTS <= 8, "PS2X_RUMBLE_SLOTS must be 1-8");
+
+public:
+    enum class Motor : uint8_t
+    {
+        Small,    // motor1, on / off: on while the envelope is above half its level
+        Large,    // motor2, 0-255
+        Both
+    };
+
+    // repeat value for effects that run until stop()
+    static constexpr uint8_t FOREVER{255};
+
+    struct Effect
+    {
+        Motor    motor;
+        uint8_t  level;       // peak strength
+        uint16_t attack;      // ramp up from 0 (mS)
+        uint16_t hold;        // at level (mS)
+        uint16_t release;     // ramp down to 0 (mS)
+        uint16_t gap;         // off between repeats (mS)
+        uint8_t  repeat;      // extra plays, FOREVER = until stopped
+        uint8_t  priority;    // higher masks lower ones on the same motor
+    };
+
+    // playing effect, 0 = none
+    using Handle = uint8_t;
+
+    // common shapes
+    static Effect pulse(Motor motor, uint8_t level, uint16_t ms, uint8_t priority = 0);
+    static Effect pulses(Motor motor, uint8_t level, uint16_t on_ms, uint16_t off_ms, uint8_t count, uint8_t priority = 0);
+    static Effect ramp(Motor motor, uint8_t from_zero_to, uint16_t ms, uint8_t priority = 0);
+
+    // start an effect at millis(). With every slot busy it replaces the lowest
+    // priority effect below its own, 0 if there is none.
+    Handle play(const Effect& effect);
+    void   stop(Handle handle);
+    void   stopAll();
+    bool   playing(Handle handle) const;
+    bool   active() const;    // any effect playing
+
+    // motor values for a frame sent at now (millis()), combined with the
+    // values the application passed (the stronger one wins)
+    void mix(uint32_t now, bool& motor1, uint8_t& motor2);
+
+private:
+    struct Slot
+    {
+        Effect   effect;
+        uint32_t start;
+        Handle   handle;    // 0 = free
+        bool     sent;      // has been in a frame
+    };
+
+    // envelope of a slot at now, false once the effect is over
+    bool level(Slot& slot, uint32_t now, uint8_t& value);
+
+    Slot    _slots[PS2X_RUMBLE_SLOTS]{};
+    uint8_t _generation{0};
+};
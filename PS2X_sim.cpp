@@ -0,0 +1,394 @@
+#include "PS2X_sim.h"
+
+namespace
+{
+    constexpr uint8_t MODE_DIGITAL = 0x41;
+    constexpr uint8_t MODE_CONFIG  = 0xF3;
+
+    // 0x4F response mask, one bit per poll reply byte: 2 button bytes, 4 sticks, 12 pressures
+    constexpr uint32_t RESPONSE_STICKS = 0x0003F;    // what analog mode starts out with
+    constexpr uint32_t RESPONSE_ALL    = 0x3FFFF;
+
+    // number of data bytes following the 0x5A header for a mode id
+    uint8_t dataBytes(uint8_t mode)
+    {
+        return (mode & 0x0F) * 2;
+    }
+
+    // analog mode id for a response mask: 0x7_ with the number of 16 bit words
+    uint8_t analogMode(uint32_t response)
+    {
+        uint8_t bytes = 0;
+        for (; response != 0; response &= response - 1)
+            bytes++;
+        return 0x70 | ((bytes + 1) / 2);
+    }
+}    // namespace
+
+PS2XSimController::PS2XSimController(Model model)
+    : _model(model)
+{
+    for (uint8_t i = 0; i < 4; i++)
+        _analog_data[i] = 0x80;    // sticks centered
+    for (uint8_t i = 4; i < sizeof(_analog_data); i++)
+        _analog_data[i] = 0x00;    // nothing pressed
+}
+
+void PS2XSimController::begin()
+{
+}
+
+void PS2XSimController::beginTransaction()
+{
+}
+
+void PS2XSimController::endTransaction()
+{
+}
+
+void PS2XSimController::setAttention(bool active)
+{
+    if (active == _attention)
+        return;
+
+    _attention = active;
+    if (active)
+    {
+        _pos      = 0;
+        _too_fast = (_max_bitrate != 0 && _bitrate > _max_bitrate) || (_min_packet_gap != 0 && millis() - _t_release < _min_packet_gap);
+        _mode     = _config ? MODE_CONFIG : modeId();
+        if (_corrupt != 0 && !_config)
+        {
+            _corrupt--;
+            _mode = MODE_DIGITAL;
+        }
+    }
+    else
+    {
+        _packets++;
+        _t_release = millis();
+        if (!_too_fast)
+            executeCommand();
+    }
+}
+
+uint8_t PS2XSimController::transfer(uint8_t out)
+{
+    if (_byte_time != 0)
+        delayMicroseconds(_byte_time);
+
+    uint32_t now = micros();
+    if (_pos != 0 && _min_byte_gap != 0 && now - _t_byte < _min_byte_gap)
+        _too_fast = true;
+    _t_byte = now;
+
+    if (!_connected || !_attention || _too_fast)
+        return 0xFF;    // DAT is pulled up
+
+    uint8_t in = replyByte(_pos);
+    if (_pos < sizeof(_rx))
+    {
+        _rx[_pos] = out;
+        _pos++;
+    }
+    return in;
+}
+
+uint8_t PS2XSimController::replyByte(uint8_t pos) const
+{
+    if (pos == 0)
+        return 0xFF;
+    if (pos == 1)
+        return _mode;
+    if (pos == 2)
+        return 0x5A;
+    if (pos - 3 >= dataBytes(_mode))
+        return 0xFF;    // past the end of the reply, nobody drives DAT
+
+    uint8_t i = pos - 3;
+
+    if (_mode != MODE_CONFIG)
+    {
+        // poll reply: buttons, then sticks, then pressures (0x42, and 0x43 outside of config mode),
+        // in analog mode only the bytes the response mask turned on
+        uint8_t field = i;
+        if (_analog)
+        {
+            uint32_t mask = _response;
+            for (uint8_t n = 0; n < i && mask != 0; n++)
+                mask &= mask - 1;    // drop the bytes before this one
+            if (mask == 0)
+                return 0x00;    // padding to a whole word
+            for (field = 0; (mask & 1) == 0; field++)
+                mask >>= 1;
+        }
+
+        if (field == 0)
+            return _buttons & 0xFF;
+        if (field == 1)
+            return _buttons >> 8;
+        return _analog_data[field - 2];
+    }
+
+    switch (_rx[1])
+    {
+        case 0x45:    // type read
+        {
+            const uint8_t reply[] = {static_cast<uint8_t>(_model == Model::DualShock ? 0x03 : 0x01), 0x02, static_cast<uint8_t>(_analog ? 0x01 : 0x00), 0x02, 0x01, 0x00};
+            return reply[i];
+        }
+        case 0x46:    // actuator info, index in byte 3
+        {
+            const uint8_t reply[2][6] = {{0x00, 0x00, 0x01, 0x02, 0x0A, 0x00}, {0x00, 0x00, 0x01, 0x01, 0x14, 0x00}};
+            return reply[_rx[3] & 0x01][i];
+        }
+        case 0x47:    // mode combinations
+        {
+            const uint8_t reply[] = {0x00, 0x00, 0x02, 0x00, 0x01, 0x00};
+            return reply[i];
+        }
+        case 0x4C:    // mode info, index in byte 3
+        {
+            const uint8_t reply[2][6] = {{0x00, 0x00, 0x00, 0x04, 0x00, 0x00}, {0x00, 0x00, 0x00, 0x07, 0x00, 0x00}};
+            return reply[_rx[3] & 0x01][i];
+        }
+        default:
+            return 0x00;
+    }
+}
+
+void PS2XSimController::executeCommand()
+{
+    if (!_connected || _pos < 4)
+        return;
+
+    switch (_rx[1])
+    {
+        case 0x42:    // poll, motor bytes only count once the rumble has been mapped
+            if (_rumble)
+            {
+                _motor_small = _rx[3];
+                _motor_large = _pos > 4 ? _rx[4] : 0;
+            }
+            break;
+        case 0x43:    // enter / exit config
+            _config = (_rx[3] == 0x01);
+            break;
+        case 0x44:    // set mode
+            if (_config)
+            {
+                _analog   = (_rx[3] == 0x01);
+                _response = RESPONSE_STICKS;
+            }
+            break;
+        case 0x4D:    // map rumble motors
+            if (_config)
+                _rumble = (_pos > 4 && _rx[3] == 0x00 && _rx[4] == 0x01);
+            break;
+        case 0x4F:    // response bytes
+            if (_config && _analog && _model == Model::DualShock && _pos > 5)
+                _response = (_rx[3] | static_cast<uint32_t>(_rx[4]) << 8 | static_cast<uint32_t>(_rx[5]) << 16) & RESPONSE_ALL;
+            break;
+    }
+}
+
+void PS2XSimController::setButton(PS2X::Button button, bool pressed)
+{
+    if (pressed)
+        _buttons &= ~static_cast<uint16_t>(button);
+    else
+        _buttons |= static_cast<uint16_t>(button);
+}
+
+void PS2XSimController::setButtons(uint16_t pressed)
+{
+    _buttons = ~pressed;
+}
+
+void PS2XSimController::setAnalog(PS2X::AnalogButton button, uint8_t value)
+{
+    _analog_data[static_cast<uint8_t>(button) - 5] = value;
+}
+
+void PS2XSimController::setConnected(bool connected)
+{
+    _connected = connected;
+    if (!connected)
+    {
+        // losing power resets the controller to its defaults
+        _config    = false;
+        _analog    = false;
+        _response  = RESPONSE_STICKS;
+        _rumble    = false;
+    }
+}
+
+void PS2XSimController::dropAnalogMode()
+{
+    _analog   = false;
+    _response = RESPONSE_STICKS;
+}
+
+void PS2XSimController::corruptFrames(uint8_t count)
+{
+    _corrupt = count;
+}
+
+void PS2XSimController::setByteTime(uint16_t us)
+{
+    _byte_time = us;
+}
+
+void PS2XSimController::setTimingLimits(uint32_t max_bitrate, uint16_t min_byte_gap_us, uint16_t min_packet_gap_ms)
+{
+    _max_bitrate    = max_bitrate;
+    _min_byte_gap   = min_byte_gap_us;
+    _min_packet_gap = min_packet_gap_ms;
+}
+
+uint32_t PS2XSimController::bitrate() const
+{
+    return _bitrate;
+}
+
+bool PS2XSimController::setBitrate(uint32_t hz)
+{
+    if (hz == 0)
+        return false;
+    _bitrate = hz;
+    return true;
+}
+
+bool PS2XSimController::inConfigMode() const
+{
+    return _config;
+}
+
+uint8_t PS2XSimController::modeId() const
+{
+    return !_analog ? MODE_DIGITAL : analogMode(_response);
+}
+
+uint8_t PS2XSimController::smallMotor() const
+{
+    return _motor_small;
+}
+
+uint8_t PS2XSimController::largeMotor() const
+{
+    return _motor_large;
+}
+
+uint32_t PS2XSimController::packets() const
+{
+    return _packets;
+}
+
+
+void PS2XSimMultitap::plug(uint8_t port, PS2XSimController* pad)
+{
+    if (port < PS2XCore::MULTITAP_PORTS)
+        _ports[port] = pad;
+}
+
+void PS2XSimMultitap::begin()
+{
+}
+
+void PS2XSimMultitap::beginTransaction()
+{
+}
+
+void PS2XSimMultitap::endTransaction()
+{
+}
+
+void PS2XSimMultitap::setAttention(bool active)
+{
+    if (active == _attention)
+        return;
+
+    _attention = active;
+    _pos       = 0;
+    _batch     = false;
+    if (!active)
+        release();
+}
+
+uint8_t PS2XSimMultitap::transfer(uint8_t out)
+{
+    if (!_attention)
+        return 0xFF;
+
+    uint8_t pos = _pos++;
+
+    if (pos == 0)
+    {
+        // address byte: talk to that port's controller directly
+        _address = out;
+        if (out >= 0x01 && out <= PS2XCore::MULTITAP_PORTS)
+            _target = _ports[out - 1];
+        if (_target != nullptr)
+        {
+            _target->setAttention(true);
+            return _target->transfer(out);
+        }
+        return 0xFF;
+    }
+
+    if (pos == 1)
+    {
+        _command = out;
+        if (_address == 0x01 && out == 0x42 && _batched)
+        {
+            _batch = true;
+            release();
+            return 0x80;
+        }
+    }
+
+    if (!_batch)
+    {
+        // a poll of port A selects the mode of the next one
+        if (pos == 2 && _address == 0x01 && _command == 0x42)
+            _batched = (out == 0x01);
+        return (_target != nullptr) ? _target->transfer(out) : 0xFF;
+    }
+
+    if (pos == 2)
+    {
+        _batched = (out == 0x01);
+        return 0x5A;
+    }
+
+    // 8 bytes per port: the command goes to the controller, its reply (without
+    // the leading high-Z byte) comes back
+    uint8_t port = (pos - 3) / 8;
+    uint8_t i    = (pos - 3) % 8;
+    if (port >= PS2XCore::MULTITAP_PORTS)
+        return 0xFF;
+
+    if (i == 0)
+    {
+        release();
+        _target = _ports[port];
+        if (_target != nullptr)
+        {
+            _target->setAttention(true);
+            _target->transfer(0x01);
+        }
+    }
+    return (_target != nullptr) ? _target->transfer(out) : 0xFF;
+}
+
+bool PS2XSimMultitap::batched() const
+{
+    return _batched;
+}
+
+void PS2XSimMultitap::release()
+{
+    if (_target != nullptr)
+        _target->setAttention(false);
+    _target = nullptr;
+}
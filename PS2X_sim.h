@@ -0,0 +1,127 @@
+#pragma once
+
+#include "PS2X_lib.h"
+
+/*
+ * Simulated DualShock / Guitar Hero controller behind the PS2XTransport
+ * interface. It answers the poll (0x42) and configuration (0x43, 0x44, 0x45,
+ * 0x4D, 0x4F) commands the way a real pad does, so PS2X - including its retry
+ * and reconfiguration logic - can run without a board, e.g. on a Linux host:
+ *
+ *     PS2XSimController pad;
+ *     PS2X              ps2x;
+ *     ps2x.begin(pad, true, true);
+ *     pad.setButton(PS2X::Button::Cross, true);
+ *     ps2x.readGamepad();
+ */
+class PS2XSimController : public PS2XTransport
+{
+public:
+    enum class Model
+    {
+        DualShock,
+        GuitarHero
+    };
+
+    explicit PS2XSimController(Model model = Model::DualShock);
+
+    void    begin() override;
+    void    beginTransaction() override;
+    void    endTransaction() override;
+    void    setAttention(bool active) override;
+    uint8_t transfer(uint8_t out) override;
+
+    uint32_t bitrate() const override;
+    bool     setBitrate(uint32_t hz) override;
+
+    /* controller state */
+    void setButton(PS2X::Button button, bool pressed);
+    void setButtons(uint16_t pressed);    // bit set = pressed, PS2X::Button layout
+    void setAnalog(PS2X::AnalogButton button, uint8_t value);
+
+    /* fault injection */
+    void setConnected(bool connected);    // unplugged controllers only return 0xFF
+    void dropAnalogMode();                // fall back to digital mode like a DualShock does on glitches
+    void corruptFrames(uint8_t count);    // garble the mode byte of the next polls
+
+    // time each transferred byte takes, spent through delayMicroseconds()
+    void setByteTime(uint16_t us);
+
+    // bus timing the controller keeps up with (0 = no limit); packets clocked
+    // faster, or with shorter gaps between bytes or packets, read back as 0xFF
+    void setTimingLimits(uint32_t max_bitrate, uint16_t min_byte_gap_us, uint16_t min_packet_gap_ms);
+
+    /* observed state */
+    bool     inConfigMode() const;
+    uint8_t  modeId() const;    // 0x41 digital, 0x7_ analog with the response mask's words (0x73 sticks, 0x79 + pressures)
+    uint8_t  smallMotor() const;
+    uint8_t  largeMotor() const;
+    uint32_t packets() const;
+
+private:
+    uint8_t replyByte(uint8_t pos) const;
+    void    executeCommand();
+
+    Model    _model;
+    bool     _connected{true};
+    bool     _attention{false};
+    bool     _config{false};
+    bool     _analog{false};
+    uint32_t _response{0x3F};    // 0x4F response mask, buttons and sticks
+    bool     _rumble{false};
+    uint8_t  _corrupt{0};
+    uint16_t _byte_time{0};
+
+    uint32_t _bitrate{250'000UL};
+    uint32_t _max_bitrate{0};
+    uint16_t _min_byte_gap{0};      // uS
+    uint16_t _min_packet_gap{0};    // mS
+    uint32_t _t_byte{0};            // micros() of the last byte
+    uint32_t _t_release{0};         // millis() of the last ATT release
+    bool     _too_fast{false};      // current packet violated a timing limit
+
+    uint16_t _buttons{0xFFFF};    // active low, as on the wire
+    uint8_t  _analog_data[16];    // PS2data[5..20]: sticks, then pressures
+    uint8_t  _motor_small{0};
+    uint8_t  _motor_large{0};
+
+    uint8_t  _rx[21]{};    // bytes received in the current packet
+    uint8_t  _pos{0};
+    uint8_t  _mode{0x41};    // mode id latched at the start of the packet
+    uint32_t _packets{0};
+};
+
+
+/*
+ * Simulated multitap with up to four PS2XSimControllers plugged in. The first
+ * packet byte addresses a port (0x01-0x04); a poll with 0x01 in its third byte
+ * switches to batched mode, where polls addressed to port A return all four
+ * ports (mode id 0x80, then 8 bytes per port, 0xFF for empty ones).
+ */
+class PS2XSimMultitap : public PS2XTransport
+{
+public:
+    // a port may be left null (nothing plugged in)
+    void plug(uint8_t port, PS2XSimController* pad);
+
+    void    begin() override;
+    void    beginTransaction() override;
+    void    endTransaction() override;
+    void    setAttention(bool active) override;
+    uint8_t transfer(uint8_t out) override;
+
+    bool batched() const;
+
+private:
+    // end the current exchange with a port's controller
+    void release();
+
+    PS2XSimController* _ports[PS2XCore::MULTITAP_PORTS]{};
+    bool               _attention{false};
+    bool               _batched{false};
+    bool               _batch{false};        // current packet is a batched read
+    uint8_t            _pos{0};
+    uint8_t            _address{0};
+    uint8_t            _command{0};
+    PS2XSimController* _target{nullptr};    // controller the current bytes go to
+};
@@ -0,0 +1,34 @@
+#include "PS2X_state.h"
+
+namespace
+{
+    constexpr uint8_t FIRST_ANALOG = 5;    // frame byte of AnalogButton::Stick_Rx
+}    // namespace
+
+void PS2XControllerState::decode(const uint8_t* frame)
+{
+    pressed = ~static_cast<uint16_t>((frame[4] << 8) | frame[3]);    // the frame is active low
+
+    for (uint8_t i = 0; i < sizeof(ps2x_state::FRAME_ORDER); i++)
+    {
+        uint8_t pos = ps2x_state::FRAME_ORDER[i];
+        if (pos < AXES)
+            sticks[pos] = frame[FIRST_ANALOG + i];
+        else
+            pressures[pos - AXES] = frame[FIRST_ANALOG + i];
+    }
+}
+
+bool PS2XControllerState::isPressed(uint16_t button) const
+{
+    return (pressed & button) != 0;
+}
+
+uint8_t PS2XControllerState::analog(uint8_t button) const
+{
+    if (button < FIRST_ANALOG || button >= FIRST_ANALOG + sizeof(ps2x_state::FRAME_ORDER))
+        return 0;
+
+    uint8_t pos = ps2x_state::FRAME_ORDER[button - FIRST_ANALOG];
+    return (pos < AXES) ? sticks[pos] : pressures[pos - AXES];
+}
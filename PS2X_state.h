@@ -0,0 +1,69 @@
+#pragma once
+
+#include "PS2X_platform.h"
+
+/*
+ * One controller frame decoded into a flat, logically ordered struct: the
+ * buttons as a pressed mask, the sticks left first and the pressures
+ * grouped by control instead of in protocol order. It has no padding and no
+ * pointers, so it can be copied, memcpy'd, compared or sent as a whole, and
+ * consumers can loop over sticks[] / pressures[] by index.
+ */
+struct PS2XControllerState
+{
+    enum Axis : uint8_t
+    {
+        LX,
+        LY,
+        RX,
+        RY,
+        AXES
+    };
+
+    enum Pressure : uint8_t
+    {
+        UP,
+        RIGHT,
+        DOWN,
+        LEFT,
+        TRIANGLE,
+        CIRCLE,
+        CROSS,
+        SQUARE,
+        L1,
+        R1,
+        L2,
+        R2,
+        PRESSURES
+    };
+
+    uint16_t pressed;                 // PS2XCore::Button bits, 1 = pressed
+    uint8_t  sticks[AXES];            // 0..255, 0x80 = centered
+    uint8_t  pressures[PRESSURES];    // 0..255, 0 without pressure mode
+
+    // fill from a raw 21 byte frame (PS2data layout)
+    void decode(const uint8_t* frame);
+
+    bool    isPressed(uint16_t button) const;    // PS2XCore::Button value
+    uint8_t analog(uint8_t button) const;        // PS2XCore::AnalogButton value, 0 if out of range
+};
+
+// layout guarantee for consumers that copy or transmit the struct as bytes
+static_assert(sizeof(PS2XControllerState) == 18, "PS2XControllerState must stay 18 bytes without padding");
+static_assert(offsetof(PS2XControllerState, sticks) == 2, "sticks must follow the button mask");
+static_assert(offsetof(PS2XControllerState, pressures) == 2 + PS2XControllerState::AXES, "pressures must follow the sticks");
+
+namespace ps2x_state
+{
+    // analog index (sticks[] then pressures[], 0-15) of frame bytes 5-20,
+    // i.e. of the AnalogButton values
+    constexpr uint8_t FRAME_ORDER[16] = {
+        PS2XControllerState::RX, PS2XControllerState::RY, PS2XControllerState::LX, PS2XControllerState::LY,
+        PS2XControllerState::AXES + PS2XControllerState::RIGHT, PS2XControllerState::AXES + PS2XControllerState::LEFT,
+        PS2XControllerState::AXES + PS2XControllerState::UP, PS2XControllerState::AXES + PS2XControllerState::DOWN,
+        PS2XControllerState::AXES + PS2XControllerState::TRIANGLE, PS2XControllerState::AXES + PS2XControllerState::CIRCLE,
+        PS2XControllerState::AXES + PS2XControllerState::CROSS, PS2XControllerState::AXES + PS2XControllerState::SQUARE,
+        PS2XControllerState::AXES + PS2XControllerState::L1, PS2XControllerState::AXES + PS2XControllerState::R1,
+        PS2XControllerState::AXES + PS2XControllerState::L2, PS2XControllerState::AXES + PS2XControllerState::R2,
+    };
+}    // namespace ps2x_state
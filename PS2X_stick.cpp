@@ -0,0 +1,255 @@
+#include "PS2X_stick.h"
+
+namespace ps2x_stick
+{
+    const CurveTable QUADRATIC = makeCurve<quadratic>();
+    const CurveTable CUBIC     = makeCurve<cubic>();
+    const CurveTable EXPO      = makeCurve<expo>();
+    const CurveTable SMOOTH    = makeCurve<smooth>();
+}    // namespace ps2x_stick
+
+using ps2x_stick::RANGE;
+
+namespace
+{
+    // travel assumed around the rest position before Auto has seen more
+    constexpr uint8_t AUTO_TRAVEL{100};
+
+    // longest frame interval the filters account for (16 uS units, ~65 mS)
+    constexpr uint16_t MAX_DT{4096};
+
+    // cutoff of the one euro derivative filter (mHz)
+    constexpr uint16_t SPEED_CUTOFF{1000};
+
+    uint32_t isqrt(uint32_t value)
+    {
+        uint32_t root = 0;
+        uint32_t bit  = 1UL << 30;
+
+        while (bit > value)
+            bit >>= 2;
+        while (bit != 0)
+        {
+            if (value >= root + bit)
+            {
+                value -= root + bit;
+                root = (root >> 1) + bit;
+            }
+            else
+                root >>= 1;
+            bit >>= 2;
+        }
+        return root;
+    }
+
+    // smoothing factor of a first order low pass, Q12:
+    // a = wT / (1 + wT), w = 2 pi cutoff, T = dt * 16 uS
+    uint16_t lowPass(uint32_t cutoff, uint16_t dt)
+    {
+        if (cutoff > 100'000UL)
+            cutoff = 100'000UL;
+
+        uint32_t wt = cutoff * 1005 / 10000 * dt;    // wT * 10^6
+        uint32_t a  = wt / ((1'000'000UL + wt) >> 12);
+        return (a < 1) ? 1 : (a > 4096) ? 4096 : a;
+    }
+
+    int16_t clampRange(int32_t value)
+    {
+        return (value > RANGE) ? RANGE : (value < -RANGE) ? -RANGE : value;
+    }
+}    // namespace
+
+PS2XStick::PS2XStick()
+    : PS2XStick(Config{Calibration::Center, Deadzone::Radial, 80, NULL, Filter::None, 64, 1000, 0})
+{
+}
+
+PS2XStick::PS2XStick(const Config& config)
+{
+    configure(config);
+}
+
+void PS2XStick::configure(const Config& config)
+{
+    _config = config;
+    if (_config.deadzone_size >= RANGE)
+        _config.deadzone_size = RANGE - 1;
+    _scale_dz = (static_cast<uint32_t>(RANGE) << 8) / (RANGE - _config.deadzone_size);
+
+    for (Axis& axis : _axis)
+    {
+        axis.center = 128;
+        axis.min    = 0;
+        axis.max    = 255;
+        rescale(axis);
+    }
+    _calibrate = (_config.calibration != Calibration::None);
+    _primed    = false;
+}
+
+const PS2XStick::Config& PS2XStick::config() const
+{
+    return _config;
+}
+
+void PS2XStick::calibrateCenter()
+{
+    _calibrate = (_config.calibration != Calibration::None);
+}
+
+void PS2XStick::update(uint8_t raw_x, uint8_t raw_y, uint32_t t)
+{
+    if (_calibrate)
+    {
+        calibrate(_axis[0], raw_x);
+        calibrate(_axis[1], raw_y);
+        _calibrate = false;
+    }
+
+    uint32_t dt = (t - _t_last) >> 4;
+    _t_last     = t;
+    if (!_primed)
+        dt = 0;
+    else if (dt > MAX_DT)
+        dt = MAX_DT;
+
+    int32_t x = filter(_axis[0], normalize(_axis[0], raw_x), dt);
+    int32_t y = filter(_axis[1], normalize(_axis[1], raw_y), dt);
+    _primed   = true;
+
+    State state;
+    if (_config.deadzone == Deadzone::Radial)
+    {
+        uint32_t distance = isqrt(x * x + y * y);
+        int32_t  m        = 0;
+
+        if (distance > _config.deadzone_size)
+            m = shape(clampRange(((distance - _config.deadzone_size) * _scale_dz) >> 8));
+
+        state.x         = (distance == 0) ? 0 : clampRange(x * m / static_cast<int32_t>(distance));
+        state.y         = (distance == 0) ? 0 : clampRange(y * m / static_cast<int32_t>(distance));
+        state.magnitude = m;
+    }
+    else
+    {
+        uint16_t size = (_config.deadzone == Deadzone::Axial) ? _config.deadzone_size : 0;
+        int32_t  v[2] = {x, y};
+
+        for (int32_t& value : v)
+        {
+            int32_t a = (value < 0) ? -value : value;
+            a         = (a <= size) ? 0 : shape(clampRange(((a - size) * _scale_dz) >> 8));
+            value     = (value < 0) ? -a : a;
+        }
+
+        uint32_t m      = isqrt(v[0] * v[0] + v[1] * v[1]);
+        state.x         = v[0];
+        state.y         = v[1];
+        state.magnitude = (m > RANGE) ? RANGE : m;
+    }
+    _state.write(state);
+}
+
+PS2XStick::State PS2XStick::state() const
+{
+    return _state.read();
+}
+
+int16_t PS2XStick::x() const
+{
+    return _state.read().x;
+}
+
+int16_t PS2XStick::y() const
+{
+    return _state.read().y;
+}
+
+void PS2XStick::calibrate(Axis& axis, uint8_t raw)
+{
+    axis.center = raw;
+    if (_config.calibration == Calibration::Auto)
+    {
+        axis.min = (raw > AUTO_TRAVEL) ? raw - AUTO_TRAVEL : 0;
+        axis.max = (raw < 255 - AUTO_TRAVEL) ? raw + AUTO_TRAVEL : 255;
+    }
+    else
+    {
+        axis.min = 0;
+        axis.max = 255;
+    }
+    rescale(axis);
+}
+
+void PS2XStick::rescale(Axis& axis)
+{
+    uint8_t lo = axis.center - axis.min;
+    uint8_t hi = axis.max - axis.center;
+
+    axis.scale_lo = (static_cast<uint32_t>(RANGE) << 8) / ((lo == 0) ? 1 : lo);
+    axis.scale_hi = (static_cast<uint32_t>(RANGE) << 8) / ((hi == 0) ? 1 : hi);
+}
+
+int16_t PS2XStick::normalize(Axis& axis, uint8_t raw)
+{
+    if (_config.calibration == Calibration::Auto && (raw < axis.min || raw > axis.max))
+    {
+        // travel further than seen so far: stretch, the only division here
+        if (raw < axis.min)
+            axis.min = raw;
+        else
+            axis.max = raw;
+        rescale(axis);
+    }
+
+    int32_t  offset = static_cast<int32_t>(raw) - axis.center;
+    uint32_t scale  = (offset < 0) ? axis.scale_lo : axis.scale_hi;
+    return clampRange((offset * static_cast<int32_t>(scale)) >> 8);
+}
+
+int16_t PS2XStick::filter(Axis& axis, int16_t value, uint16_t dt)
+{
+    int32_t sample = static_cast<int32_t>(value) << 4;
+
+    if (_config.filter == Filter::None || dt == 0)
+    {
+        // first sample (or filter off) seeds the state
+        axis.value = sample;
+        axis.last  = value;
+        axis.speed = 0;
+        return value;
+    }
+
+    uint16_t a;
+    if (_config.filter == Filter::Ema)
+        a = (_config.ema_weight == 0) ? 16 : static_cast<uint16_t>(_config.ema_weight) << 4;
+    else
+    {
+        // cutoff follows the filtered speed of the axis
+        int32_t speed = (static_cast<int32_t>(value) - axis.last) * 62500 / dt;    // RANGE units / s
+        speed         = (speed > 32767) ? 32767 : (speed < -32767) ? -32767 : speed;
+        axis.speed += ((speed - axis.speed) * lowPass(SPEED_CUTOFF, dt)) >> 12;
+
+        uint32_t fast = (axis.speed < 0) ? -axis.speed : axis.speed;
+        a = lowPass(_config.min_cutoff + ((static_cast<uint32_t>(_config.beta) * fast) >> 10), dt);
+    }
+    axis.last = value;
+
+    axis.value += ((sample - axis.value) * a + 2048) >> 12;
+    return axis.value >> 4;
+}
+
+int16_t PS2XStick::shape(int16_t value) const
+{
+    if (_config.curve == NULL)
+        return value;
+
+    const uint16_t* points = _config.curve->points;
+    uint8_t         i      = value >> 5;    // RANGE / (CURVE_POINTS - 1) = 32 per segment
+    if (i >= ps2x_stick::CURVE_POINTS - 1)
+        return points[ps2x_stick::CURVE_POINTS - 1];
+
+    int32_t from = points[i];
+    return from + (((static_cast<int32_t>(points[i + 1]) - from) * (value & 31)) >> 5);
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "PS2X_platform.h"
+#include "PS2X_sync.h"
+
+namespace ps2x_stick
+{
+    // full deflection of a processed axis
+    constexpr int16_t RANGE{1024};
+
+    // response curve sampled at 0, 1/32, ... 32/32 of full deflection,
+    // interpolated linearly in between
+    constexpr uint8_t CURVE_POINTS{33};
+
+    struct CurveTable
+    {
+        uint16_t points[CURVE_POINTS];
+    };
+
+    // build a table at compile time from a constexpr function mapping
+    // 0..RANGE to 0..RANGE, e.g.
+    //   constexpr uint16_t half(uint16_t x) { return x / 2; }
+    //   constexpr ps2x_stick::CurveTable slow = ps2x_stick::makeCurve<half>();
+    template <uint16_t (*Shape)(uint16_t)>
+    constexpr CurveTable makeCurve()
+    {
+        CurveTable table{};
+        for (uint8_t i = 0; i < CURVE_POINTS; i++)
+            table.points[i] = Shape(i * (RANGE / (CURVE_POINTS - 1)));
+        return table;
+    }
+
+    constexpr uint16_t quadratic(uint16_t x)
+    {
+        return static_cast<uint32_t>(x) * x / RANGE;
+    }
+
+    constexpr uint16_t cubic(uint16_t x)
+    {
+        return static_cast<uint32_t>(x) * x / RANGE * x / RANGE;
+    }
+
+    // half linear, half cubic (RC style "50% expo")
+    constexpr uint16_t expo(uint16_t x)
+    {
+        return (x + cubic(x)) / 2;
+    }
+
+    // smoothstep: gentle at both ends
+    constexpr uint16_t smooth(uint16_t x)
+    {
+        return static_cast<uint32_t>(x) * x / RANGE * (3 * RANGE - 2 * x) / RANGE;
+    }
+
+    // ready-made tables, only the ones referenced are linked
+    extern const CurveTable QUADRATIC;
+    extern const CurveTable CUBIC;
+    extern const CurveTable EXPO;
+    extern const CurveTable SMOOTH;
+}    // namespace ps2x_stick
+
+
+/*
+ * Per-stick processing run once per decoded frame (see PS2XCore::attachStick()),
+ * all integer math: calibration -> filter -> deadzone -> response curve. The
+ * result is cached, reading it costs a copy of six bytes.
+ */
+class PS2XStick
+{
+public:
+    enum class Calibration
+    {
+        None,      // raw 0..255 around 128
+        Center,    // rest position taken by calibrateCenter() (or the first frame), full 0..255 travel
+        Auto       // like Center, travel learned from the extremes seen so far
+    };
+
+    enum class Deadzone
+    {
+        None,
+        Axial,     // per axis, curve applied per axis
+        Radial     // on the distance from center, direction kept
+    };
+
+    enum class Filter
+    {
+        None,
+        Ema,       // exponential moving average with a fixed weight
+        OneEuro    // adaptive low pass: smooth at rest, little lag when moving fast
+    };
+
+    struct Config
+    {
+        Calibration                   calibration;
+        Deadzone                      deadzone;
+        uint16_t                      deadzone_size;    // 0..RANGE
+        const ps2x_stick::CurveTable* curve;            // NULL = linear
+        Filter                        filter;
+        uint8_t                       ema_weight;       // Ema: weight of a new sample (1/256)
+        uint16_t                      min_cutoff;       // OneEuro: cutoff at rest (mHz)
+        uint16_t                      beta;             // OneEuro: cutoff increase (mHz per full deflection per second)
+    };
+
+    // result of the last frame
+    struct State
+    {
+        int16_t  x;            // -RANGE..RANGE, same orientation as PS2XCore::analog()
+        int16_t  y;
+        uint16_t magnitude;    // distance from center, 0..RANGE
+    };
+
+    PS2XStick();
+    explicit PS2XStick(const Config& config);
+
+    // replace the settings, restarts calibration and filters
+    void          configure(const Config& config);
+    const Config& config() const;
+
+    // run the pipeline on one raw sample (analog() values), t = micros()
+    void update(uint8_t raw_x, uint8_t raw_y, uint32_t t);
+
+    // take the next sample as rest position (Center / Auto) and forget the
+    // learned travel (Auto)
+    void calibrateCenter();
+
+    // latest result, safe to call from any task or core
+    State   state() const;
+    int16_t x() const;
+    int16_t y() const;
+
+private:
+    struct Axis
+    {
+        uint8_t  center;
+        uint8_t  min;
+        uint8_t  max;
+        uint32_t scale_lo;    // RANGE / (center - min), Q8
+        uint32_t scale_hi;    // RANGE / (max - center), Q8
+        int32_t  value;       // filter output, Q4
+        int16_t  last;        // previous calibrated sample
+        int32_t  speed;       // filtered derivative (RANGE units / s)
+    };
+
+    void    calibrate(Axis& axis, uint8_t raw);
+    void    rescale(Axis& axis);
+    int16_t normalize(Axis& axis, uint8_t raw);
+    int16_t filter(Axis& axis, int16_t value, uint16_t dt);
+    int16_t shape(int16_t value) const;
+
+    Config   _config;
+    Axis     _axis[2]{};
+    uint32_t _scale_dz{0};    // RANGE / (RANGE - deadzone_size), Q8
+    uint32_t _t_last{0};
+    bool     _calibrate{true};    // next sample is the rest position
+    bool     _primed{false};      // filters hold a sample
+
+    PS2XSeqLock<State> _state;
+};
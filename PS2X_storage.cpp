@@ -0,0 +1,137 @@
+#include "PS2X_storage.h"
+#include "PS2X_crc.h"
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include <Preferences.h>
+#elif defined(ARDUINO_ARCH_ESP8266) || defined(__AVR__)
+#include <EEPROM.h>
+#endif
+
+namespace
+{
+    constexpr uint8_t STORAGE_MAGIC   = 0xB5;
+    constexpr uint8_t STORAGE_VERSION = 1;
+    constexpr uint8_t STORAGE_HEADER  = 3;    // magic, version, length - followed by data and CRC
+    constexpr uint8_t RECORD_KINDS    = 2;
+
+    constexpr size_t STORAGE_SIZE = RECORD_KINDS * PS2X_STORAGE_SLOTS * PS2X_STORAGE_RECORD_SIZE;
+
+    bool encode(uint8_t* buf, const void* data, uint8_t len)
+    {
+        if (len + STORAGE_HEADER + 1 > PS2X_STORAGE_RECORD_SIZE)
+            return false;
+
+        buf[0] = STORAGE_MAGIC;
+        buf[1] = STORAGE_VERSION;
+        buf[2] = len;
+        memcpy(buf + STORAGE_HEADER, data, len);
+        buf[STORAGE_HEADER + len] = ps2x_crc8(buf, STORAGE_HEADER + len);
+        return true;
+    }
+
+    bool decode(const uint8_t* buf, void* data, uint8_t len)
+    {
+        if (buf[0] != STORAGE_MAGIC || buf[1] != STORAGE_VERSION || buf[2] != len)
+            return false;
+        if (buf[STORAGE_HEADER + len] != ps2x_crc8(buf, STORAGE_HEADER + len))
+            return false;
+
+        memcpy(data, buf + STORAGE_HEADER, len);
+        return true;
+    }
+
+    bool valid(ps2x_storage::Record record, uint8_t slot)
+    {
+        return static_cast<uint8_t>(record) < RECORD_KINDS && slot < PS2X_STORAGE_SLOTS;
+    }
+
+    size_t offset(ps2x_storage::Record record, uint8_t slot)
+    {
+        return (static_cast<uint8_t>(record) * PS2X_STORAGE_SLOTS + slot) * PS2X_STORAGE_RECORD_SIZE;
+    }
+
+#if defined(ARDUINO_ARCH_ESP32)
+    void key(char* buf, ps2x_storage::Record record, uint8_t slot)
+    {
+        buf[0] = 'r';
+        buf[1] = '0' + static_cast<uint8_t>(record);
+        buf[2] = '_';
+        buf[3] = '0' + slot;
+        buf[4] = '\0';
+    }
+#elif !defined(ARDUINO)
+    uint8_t host_storage[STORAGE_SIZE];
+#endif
+}    // namespace
+
+bool ps2x_storage::save(Record record, uint8_t slot, const void* data, uint8_t len)
+{
+    uint8_t buf[PS2X_STORAGE_RECORD_SIZE];
+
+    if (!valid(record, slot) || !encode(buf, data, len))
+        return false;
+
+    size_t size = STORAGE_HEADER + len + 1;
+
+#if defined(ARDUINO_ARCH_ESP32)
+    char        name[5];
+    Preferences prefs;
+    key(name, record, slot);
+    if (!prefs.begin("ps2x", false))
+        return false;
+    bool ok = prefs.putBytes(name, buf, size) == size;
+    prefs.end();
+    return ok;
+#elif defined(ARDUINO_ARCH_ESP8266)
+    EEPROM.begin(PS2X_STORAGE_OFFSET + STORAGE_SIZE);
+    for (size_t i = 0; i < size; i++)
+        EEPROM.write(PS2X_STORAGE_OFFSET + offset(record, slot) + i, buf[i]);
+    return EEPROM.commit();
+#elif defined(__AVR__)
+    for (size_t i = 0; i < size; i++)
+        EEPROM.update(PS2X_STORAGE_OFFSET + offset(record, slot) + i, buf[i]);
+    return true;
+#elif !defined(ARDUINO)
+    memcpy(host_storage + offset(record, slot), buf, size);
+    return true;
+#else
+    (void) size;
+    return false;    // no non-volatile storage on this core
+#endif
+}
+
+bool ps2x_storage::load(Record record, uint8_t slot, void* data, uint8_t len)
+{
+    uint8_t buf[PS2X_STORAGE_RECORD_SIZE];
+
+    if (!valid(record, slot) || len + STORAGE_HEADER + 1 > PS2X_STORAGE_RECORD_SIZE)
+        return false;
+
+    size_t size = STORAGE_HEADER + len + 1;
+
+#if defined(ARDUINO_ARCH_ESP32)
+    char        name[5];
+    Preferences prefs;
+    key(name, record, slot);
+    if (!prefs.begin("ps2x", true))
+        return false;
+    bool ok = prefs.getBytes(name, buf, size) == size;
+    prefs.end();
+    if (!ok)
+        return false;
+#elif defined(ARDUINO_ARCH_ESP8266)
+    EEPROM.begin(PS2X_STORAGE_OFFSET + STORAGE_SIZE);
+    for (size_t i = 0; i < size; i++)
+        buf[i] = EEPROM.read(PS2X_STORAGE_OFFSET + offset(record, slot) + i);
+#elif defined(__AVR__)
+    for (size_t i = 0; i < size; i++)
+        buf[i] = EEPROM.read(PS2X_STORAGE_OFFSET + offset(record, slot) + i);
+#elif !defined(ARDUINO)
+    memcpy(buf, host_storage + offset(record, slot), size);
+#else
+    (void) size;
+    return false;    // no non-volatile storage on this core
+#endif
+
+    return decode(buf, data, len);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "PS2X_platform.h"
+
+// $$$$$$$$$$$$ STORAGE CONFIGURATION $$$$$$$$$$$$$$$$
+// EEPROM area used on ESP8266/AVR (ESP32 uses the "ps2x" NVS namespace):
+// PS2X_STORAGE_SLOTS records of each kind, PS2X_STORAGE_RECORD_SIZE bytes each
+#ifndef PS2X_STORAGE_OFFSET
+#    define PS2X_STORAGE_OFFSET 0
+#endif
+#ifndef PS2X_STORAGE_SLOTS
+#    define PS2X_STORAGE_SLOTS 2
+#endif
+#ifndef PS2X_STORAGE_RECORD_SIZE
+#    define PS2X_STORAGE_RECORD_SIZE 48
+#endif
+
+/*
+ * Small non-volatile records (timing profiles, controller capabilities) that
+ * survive a reboot. Every record carries a version, its length and a CRC, so
+ * a record written by another library version or never written at all fails
+ * to load instead of returning garbage. Without NVS/EEPROM support (or on the
+ * host, where the records are kept in RAM) load() simply finds nothing
+ * persisted.
+ */
+namespace ps2x_storage
+{
+    enum class Record : uint8_t
+    {
+        Timing,
+        Capabilities,
+    };
+
+    // data may be up to PS2X_STORAGE_RECORD_SIZE - 4 bytes
+    bool save(Record record, uint8_t slot, const void* data, uint8_t len);
+    bool load(Record record, uint8_t slot, void* data, uint8_t len);
+}    // namespace ps2x_storage
@@ -0,0 +1,390 @@
+#include "PS2X_stream.h"
+
+#include "PS2X_crc.h"
+#include "PS2X_lib.h"
+
+using namespace ps2x_stream;
+
+namespace
+{
+    constexpr uint8_t TYPE_KEYFRAME = 0;
+    constexpr uint8_t TYPE_DELTA    = 1;
+
+    constexpr uint8_t BITS[4] = {8, 6, 5, 4};    // by quantization code
+
+    // values of fields missing from a keyframe
+    constexpr uint8_t STICK_REST    = 0x80;
+    constexpr uint8_t PRESSURE_REST = 0x00;
+
+    constexpr uint8_t FIELDS = PS2XControllerState::AXES + PS2XControllerState::PRESSURES;
+
+    // analog field i: sticks first, then pressures. Indexed as the bytes of
+    // the state, where PS2X_state.h guarantees the pressures follow the
+    // sticks without a gap; indexing sticks[] past its end would be UB.
+    uint8_t& field(PS2XControllerState& state, uint8_t i)
+    {
+        return (reinterpret_cast<uint8_t*>(&state) + offsetof(PS2XControllerState, sticks))[i];
+    }
+
+    uint8_t field(const PS2XControllerState& state, uint8_t i)
+    {
+        return (reinterpret_cast<const uint8_t*>(&state) + offsetof(PS2XControllerState, sticks))[i];
+    }
+
+    uint8_t restValue(uint8_t i)
+    {
+        return (i < PS2XControllerState::AXES) ? STICK_REST : PRESSURE_REST;
+    }
+
+    uint8_t fieldCount(uint32_t mask)
+    {
+        uint8_t n = 0;
+        for (; mask != 0; mask &= mask - 1)
+            n++;
+        return n;
+    }
+
+    // LEB128 field mask, at most 3 bytes for 17 bits
+    uint8_t encodeMask(uint32_t mask, uint8_t* out)
+    {
+        uint8_t n = 0;
+        while (mask >= 0x80)
+        {
+            out[n++] = static_cast<uint8_t>(mask) | 0x80;
+            mask >>= 7;
+        }
+        out[n++] = static_cast<uint8_t>(mask);
+        return n;
+    }
+
+    // false while the mask continues past len
+    bool decodeMask(const uint8_t* data, uint8_t len, uint8_t& pos, uint32_t& mask)
+    {
+        mask = 0;
+        for (uint8_t shift = 0; shift < 21 && pos < len; shift += 7)
+        {
+            uint8_t b = data[pos++];
+            mask |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    // bytes of the analog fields in mask at bits each
+    uint8_t payloadLength(uint32_t mask, uint8_t bits)
+    {
+        return ((mask & FIELD_BUTTONS) ? 2 : 0) + (fieldCount(mask & ~FIELD_BUTTONS) * bits + 7) / 8;
+    }
+}    // namespace
+
+/****************************************************************************************/
+PS2XStreamEncoder::PS2XStreamEncoder(uint8_t bits, uint8_t keyframe_interval)
+    : _bits(8)
+    , _quantization(0)
+    , _keyframe_interval(keyframe_interval)
+{
+    for (uint8_t i = 0; i < sizeof(BITS); i++)
+    {
+        if (BITS[i] == bits)
+        {
+            _bits         = bits;
+            _quantization = i;
+        }
+    }
+}
+
+void PS2XStreamEncoder::requestKeyframe()
+{
+    _keyframe = true;
+}
+
+uint8_t PS2XStreamEncoder::quantize(uint8_t value) const
+{
+    return value >> (8 - _bits);
+}
+
+uint8_t PS2XStreamEncoder::encode(const PS2XControllerState& state, uint8_t* out, uint32_t hint)
+{
+    if (_keyframe_interval != 0 && _since_keyframe >= _keyframe_interval)
+        _keyframe = true;
+
+    uint32_t mask = 0;
+    if (_keyframe)
+    {
+        // everything that isn't at rest
+        mask = FIELD_BUTTONS;
+        for (uint8_t i = 0; i < FIELDS; i++)
+        {
+            if (quantize(field(state, i)) != quantize(restValue(i)))
+                mask |= 1UL << (i + 1);
+        }
+    }
+    else
+    {
+        // what changed since the last packet, as the receiver would see it
+        if ((hint & FIELD_BUTTONS) && state.pressed != _sent.pressed)
+            mask = FIELD_BUTTONS;
+        for (uint8_t i = 0; i < FIELDS; i++)
+        {
+            if ((hint & (1UL << (i + 1))) && quantize(field(state, i)) != quantize(field(_sent, i)))
+                mask |= 1UL << (i + 1);
+        }
+        if (mask == 0)
+            return 0;
+    }
+
+    uint8_t len = 0;
+    out[len++]  = SYNC;
+    out[len++]  = (VERSION << 4) | (_quantization << 2) | (_keyframe ? TYPE_KEYFRAME : TYPE_DELTA);
+    out[len++]  = _seq++;
+    len += encodeMask(mask, out + len);
+
+    if (mask & FIELD_BUTTONS)
+    {
+        out[len++]    = state.pressed & 0xFF;
+        out[len++]    = state.pressed >> 8;
+        _sent.pressed = state.pressed;
+    }
+
+    // analog fields bit packed, LSB first
+    uint16_t acc   = 0;
+    uint8_t  count = 0;
+    for (uint8_t i = 0; i < FIELDS; i++)
+    {
+        if (_keyframe)
+            field(_sent, i) = restValue(i);
+        if (!(mask & (1UL << (i + 1))))
+            continue;
+
+        acc |= static_cast<uint16_t>(quantize(field(state, i))) << count;
+        count += _bits;
+        if (count >= 8)
+        {
+            out[len++] = acc & 0xFF;
+            acc >>= 8;
+            count -= 8;
+        }
+        field(_sent, i) = field(state, i);
+    }
+    if (count != 0)
+        out[len++] = acc & 0xFF;
+
+    out[len] = ps2x_crc8(out + 1, len - 1);
+    len++;
+
+    _since_keyframe = _keyframe ? 0 : _since_keyframe + 1;
+    _keyframe       = false;
+    return len;
+}
+
+uint8_t PS2XStreamEncoder::encode(const PS2XCore& ps2x, uint8_t* out)
+{
+    PS2XCore::Snapshot snap = ps2x.snapshot();
+    if (snap.frame == _frame)
+        return 0;
+
+    // the dirty mask only covers the latest frame: after skipped frames
+    // compare everything, a change that only showed up in one of them
+    // would never be sent otherwise
+    uint32_t hint = FIELD_ALL;
+    if (snap.frame == _frame + 1)
+    {
+        // dirty frame bytes 5-20 to fields
+        hint = (snap.dirty & PS2XCore::DIRTY_BUTTONS) ? FIELD_BUTTONS : 0;
+        for (uint8_t i = 0; i < FIELDS; i++)
+        {
+            if (snap.dirty & (1UL << (i + 5)))
+                hint |= 1UL << (ps2x_state::FRAME_ORDER[i] + 1);
+        }
+    }
+    _frame = snap.frame;
+
+    if (hint == 0 && !_keyframe && (_keyframe_interval == 0 || _since_keyframe < _keyframe_interval))
+        return 0;
+
+    return encode(snap.state, out, hint);
+}
+
+/****************************************************************************************/
+PS2XStreamDecoder::PS2XStreamDecoder()
+{
+    _state.pressed = 0;
+    for (uint8_t i = 0; i < FIELDS; i++)
+        field(_state, i) = restValue(i);
+}
+
+PS2XStreamDecoder::Result PS2XStreamDecoder::push(uint8_t byte)
+{
+    if (_len == 0 && byte != SYNC)
+        return Result::None;
+
+    _buffer[_len++] = byte;
+
+    uint8_t expected = expectedLength();
+    if (expected == 0 || _len < expected)
+        return Result::None;
+
+    Result result = apply();
+    if (result == Result::CrcError)
+    {
+        // maybe the sync byte was payload: rescan what came after it
+        uint8_t rest[MAX_PACKET];
+        uint8_t n = _len - 1;
+
+        memcpy(rest, _buffer + 1, n);
+        _len = 0;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            Result again = push(rest[i]);
+            if (again != Result::None)
+                result = again;
+        }
+        return result;
+    }
+    _len = 0;
+    return result;
+}
+
+PS2XStreamDecoder::Result PS2XStreamDecoder::decode(const uint8_t* data, size_t len)
+{
+    if (len < 5 || len > MAX_PACKET || data[0] != SYNC)
+    {
+        _crc_errors++;
+        return Result::CrcError;
+    }
+
+    memcpy(_buffer, data, len);
+    _len = len;
+
+    Result result;
+    if (expectedLength() != len)
+    {
+        _crc_errors++;
+        result = Result::CrcError;
+    }
+    else
+        result = apply();
+    _len = 0;
+    return result;
+}
+
+uint8_t PS2XStreamDecoder::expectedLength() const
+{
+    if (_len < 4)
+        return 0;
+
+    uint8_t  pos = 3;
+    uint32_t mask;
+    if (!decodeMask(_buffer, _len, pos, mask))
+        return (pos >= 6) ? pos : 0;    // overlong mask: let the CRC reject it
+
+    uint8_t len = pos + payloadLength(mask & FIELD_ALL, BITS[(_buffer[1] >> 2) & 0x03]) + 1;
+    return (len > MAX_PACKET) ? pos : len;
+}
+
+PS2XStreamDecoder::Result PS2XStreamDecoder::apply()
+{
+    uint8_t len = _len;
+    if (len < 5 || ps2x_crc8(_buffer + 1, len - 2) != _buffer[len - 1])
+    {
+        _crc_errors++;
+        return Result::CrcError;
+    }
+
+    if ((_buffer[1] >> 4) != VERSION)
+        return Result::Version;
+
+    bool    keyframe = (_buffer[1] & 0x03) == TYPE_KEYFRAME;
+    uint8_t seq      = _buffer[2];
+
+    if (!keyframe && (!_synced || seq != static_cast<uint8_t>(_seq + 1)))
+    {
+        _synced = false;
+        _gaps++;
+        return Result::Gap;
+    }
+
+    uint8_t  pos = 3;
+    uint32_t mask;
+    decodeMask(_buffer, len, pos, mask);
+    mask &= FIELD_ALL;
+
+    uint8_t bits = BITS[(_buffer[1] >> 2) & 0x03];
+
+    if (mask & FIELD_BUTTONS)
+    {
+        _state.pressed = _buffer[pos] | (_buffer[pos + 1] << 8);
+        pos += 2;
+    }
+
+    uint16_t acc   = 0;
+    uint8_t  count = 0;
+    for (uint8_t i = 0; i < FIELDS; i++)
+    {
+        if (!(mask & (1UL << (i + 1))))
+        {
+            if (keyframe)
+                field(_state, i) = restValue(i);
+            continue;
+        }
+
+        if (count < bits)
+        {
+            acc |= static_cast<uint16_t>(_buffer[pos++]) << count;
+            count += 8;
+        }
+        uint8_t q = acc & ((1 << bits) - 1);
+        acc >>= bits;
+        count -= bits;
+
+        // keep 0x80 centered and full deflection at 0xFF
+        field(_state, i) = (q == (1 << bits) - 1) ? 0xFF : q << (8 - bits);
+    }
+
+    _seq     = seq;
+    _synced  = true;
+    _changed = keyframe ? FIELD_ALL : mask;
+    _packets++;
+    return Result::Frame;
+}
+
+const PS2XControllerState& PS2XStreamDecoder::state() const
+{
+    return _state;
+}
+
+uint32_t PS2XStreamDecoder::changed() const
+{
+    return _changed;
+}
+
+bool PS2XStreamDecoder::synced() const
+{
+    return _synced;
+}
+
+bool PS2XStreamDecoder::isPressed(uint16_t button) const
+{
+    return _state.isPressed(button);
+}
+
+uint8_t PS2XStreamDecoder::analog(uint8_t button) const
+{
+    return _state.analog(button);
+}
+
+uint32_t PS2XStreamDecoder::packets() const
+{
+    return _packets;
+}
+
+uint32_t PS2XStreamDecoder::crcErrors() const
+{
+    return _crc_errors;
+}
+
+uint32_t PS2XStreamDecoder::gaps() const
+{
+    return _gaps;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "PS2X_platform.h"
+#include "PS2X_state.h"
+
+/*
+ * Compact wire format for forwarding controller input to another MCU or a PC
+ * (UART, radio, ...). The encoder sends a keyframe, then only the fields that
+ * changed; the decoder rebuilds the state on the other side and does not need
+ * the rest of the library.
+ *
+ *     uint8_t  sync 0xA5
+ *     uint8_t  version << 4 | quantization << 2 | type (0 = keyframe, 1 = delta)
+ *     uint8_t  sequence number
+ *     varint   field mask (LEB128): bit 0 buttons, bits 1-16 the sticks and
+ *              pressures in PS2XControllerState order
+ *     uint16_t pressed buttons, little endian (if in the mask)
+ *     analog fields of the mask in order, 8/6/5/4 bits each by quantization,
+ *              packed LSB first and padded to a byte
+ *     uint8_t  CRC-8 (see PS2X_crc.h) of everything after the sync byte
+ *
+ * Fields missing from a keyframe are at rest (sticks 0x80, pressures 0).
+ * A delta only applies on top of the packet right before it: after a lost or
+ * corrupted packet the decoder waits for the next keyframe.
+ */
+
+class PS2XCore;
+
+namespace ps2x_stream
+{
+    constexpr uint8_t SYNC       = 0xA5;
+    constexpr uint8_t VERSION    = 2;     // 1: fields in frame order, buttons active low
+    constexpr uint8_t MAX_PACKET = 25;    // keyframe with every field, no quantization
+
+    constexpr uint32_t FIELD_BUTTONS   = 0x0'0001UL;
+    constexpr uint32_t FIELD_STICKS    = 0x0'001EUL;
+    constexpr uint32_t FIELD_PRESSURES = 0x1'FFE0UL;
+    constexpr uint32_t FIELD_ALL       = 0x1'FFFFUL;
+}    // namespace ps2x_stream
+
+class PS2XStreamEncoder
+{
+public:
+    // bits per analog value (8, 6, 5 or 4), a keyframe every keyframe_interval
+    // packets (0 = only the first one and on requestKeyframe())
+    explicit PS2XStreamEncoder(uint8_t bits = 8, uint8_t keyframe_interval = 32);
+
+    // packet for state into out (MAX_PACKET bytes), 0 if nothing changed.
+    // hint limits the fields compared, e.g. to a dirty mask.
+    uint8_t encode(const PS2XControllerState& state, uint8_t* out, uint32_t hint = ps2x_stream::FIELD_ALL);
+
+    // packet for the latest frame of ps2x, driven by its dirtyMask(); 0 if
+    // there is no new frame or nothing changed. Safe from any task or core,
+    // also at a lower rate than the frames are polled (frames skipped since
+    // the last call are caught up with a full comparison).
+    uint8_t encode(const PS2XCore& ps2x, uint8_t* out);
+
+    // make the next packet a keyframe, e.g. when the receiver lost sync
+    void requestKeyframe();
+
+private:
+    uint8_t quantize(uint8_t value) const;
+
+    uint8_t             _bits;
+    uint8_t             _quantization;    // header code of _bits
+    uint8_t             _keyframe_interval;
+    uint8_t             _since_keyframe{0};
+    bool                _keyframe{true};
+    uint8_t             _seq{0};
+    uint32_t            _frame{0};    // last PS2XCore frame encoded
+    PS2XControllerState _sent{};      // state as the receiver has it
+};
+
+class PS2XStreamDecoder
+{
+public:
+    enum class Result
+    {
+        None,        // packet incomplete, feed more bytes
+        Frame,       // state() updated
+        CrcError,    // corrupted packet dropped
+        Gap,         // delta without the packet before it, waiting for a keyframe
+        Version      // packet of an unknown format version
+    };
+
+    PS2XStreamDecoder();
+
+    // byte by byte, straight from a UART; resynchronizes on the next sync byte
+    Result push(uint8_t byte);
+
+    // one complete packet, e.g. a radio datagram
+    Result decode(const uint8_t* data, size_t len);
+
+    const PS2XControllerState& state() const;
+    uint32_t                   changed() const;    // field mask of the last applied packet
+    bool                       synced() const;     // a keyframe and every delta since have arrived
+
+    bool    isPressed(uint16_t button) const;    // PS2XCore::Button value
+    uint8_t analog(uint8_t button) const;        // PS2XCore::AnalogButton value
+
+    uint32_t packets() const;
+    uint32_t crcErrors() const;
+    uint32_t gaps() const;
+
+private:
+    // length of the packet in _buffer once its header and mask are in, 0 = unknown yet
+    uint8_t expectedLength() const;
+    Result  apply();
+
+    uint8_t _buffer[ps2x_stream::MAX_PACKET];
+    uint8_t _len{0};
+
+    PS2XControllerState _state;
+    uint32_t            _changed{0};
+    uint8_t             _seq{0};
+    bool                _synced{false};
+
+    uint32_t _packets{0};
+    uint32_t _crc_errors{0};
+    uint32_t _gaps{0};
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "PS2X_platform.h"
+
+/*
+ * Single writer / many readers sequence lock. The writer never waits, readers
+ * retry until they copied a value that wasn't modified meanwhile, so a reader
+ * in another task or on another core always sees a consistent T without any
+ * mutex. read() must not run in an ISR that can interrupt the writer on the
+ * same core - it would spin forever on the half written value - such readers
+ * use tryRead(). T must be trivially copyable.
+ */
+template <class T>
+class PS2XSeqLock
+{
+public:
+    void write(const T& value)
+    {
+        uint32_t seq = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+        __atomic_store_n(&_seq, seq + 1, __ATOMIC_RELAXED);    // odd = write in progress
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+        memcpy(&_value, &value, sizeof(T));
+        __atomic_store_n(&_seq, seq + 2, __ATOMIC_RELEASE);
+    }
+
+    T read() const
+    {
+        T        copy;
+        uint32_t before;
+        uint32_t after;
+
+        do
+        {
+            before = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+            memcpy(&copy, &_value, sizeof(T));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&_seq, __ATOMIC_RELAXED);
+        } while ((before & 1) != 0 || before != after);
+
+        return copy;
+    }
+
+    // single attempt of read(), false if a write was in progress or
+    // completed meanwhile (value is left unspecified then)
+    bool tryRead(T& value) const
+    {
+        uint32_t before = __atomic_load_n(&_seq, __ATOMIC_ACQUIRE);
+        if ((before & 1) != 0)
+            return false;
+
+        memcpy(&value, &_value, sizeof(T));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        return __atomic_load_n(&_seq, __ATOMIC_RELAXED) == before;
+    }
+
+    // number of completed writes
+    uint32_t version() const
+    {
+        return __atomic_load_n(&_seq, __ATOMIC_ACQUIRE) / 2;
+    }
+
+private:
+    T        _value{};
+    uint32_t _seq{0};
+};
+
+
+/*
+ * Fixed capacity single producer / single consumer ring buffer. push() and
+ * pop() may run on different cores, tasks or in an ISR without locking; when
+ * the ring is full new items are dropped and counted in overflows().
+ */
+template <class T, uint8_t Capacity>
+class PS2XRing
+{
+    static_assert(Capacity > 0 && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two up to 128");
+
+public:
+    // producer side
+    bool push(const T& item)
+    {
+        uint8_t head = __atomic_load_n(&_head, __ATOMIC_RELAXED);
+        uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_ACQUIRE);
+
+        if (static_cast<uint8_t>(head - tail) >= Capacity)
+        {
+            __atomic_store_n(&_overflows, _overflows + 1, __ATOMIC_RELAXED);    // only the producer writes it
+            return false;
+        }
+
+        _items[head & (Capacity - 1)] = item;
+        __atomic_store_n(&_head, static_cast<uint8_t>(head + 1), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    // consumer side
+    bool pop(T& item)
+    {
+        uint8_t tail = __atomic_load_n(&_tail, __ATOMIC_RELAXED);
+        uint8_t head = __atomic_load_n(&_head, __ATOMIC_ACQUIRE);
+
+        if (head == tail)
+            return false;
+
+        item = _items[tail & (Capacity - 1)];
+        __atomic_store_n(&_tail, static_cast<uint8_t>(tail + 1), __ATOMIC_RELEASE);
+        return true;
+    }
+
+    uint8_t size() const
+    {
+        return static_cast<uint8_t>(__atomic_load_n(&_head, __ATOMIC_ACQUIRE) - __atomic_load_n(&_tail, __ATOMIC_ACQUIRE));
+    }
+
+    uint32_t overflows() const
+    {
+        return __atomic_load_n(&_overflows, __ATOMIC_RELAXED);
+    }
+
+private:
+    T        _items[Capacity];
+    uint8_t  _head{0};    // written by the producer only
+    uint8_t  _tail{0};    // written by the consumer only
+    uint32_t _overflows{0};
+};
@@ -0,0 +1,268 @@
+#include "PS2X_timer_spi.h"
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+
+#define CHK(x, y) (x & (1 << y))
+
+namespace
+{
+#if defined(ARDUINO_ARCH_ESP32)
+    // 10 MHz timer clock, 100 nS resolution
+    constexpr uint32_t TIMER_HZ = 10'000'000UL;
+
+    hw_timer_t* timer = NULL;
+#else
+    // timer1 at TIM_DIV1 counts at 80 MHz
+    constexpr uint32_t TIMER_HZ = 80'000'000UL;
+#endif
+
+    constexpr uint32_t TIMER_NS = 1'000'000'000UL / TIMER_HZ;
+}    // namespace
+
+PS2XTimerSPI* PS2XTimerSPI::_active = nullptr;
+
+PS2XTimerSPI::PS2XTimerSPI(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat)
+    : _clk_pin(clk), _cmd_pin(cmd), _att_pin(att), _dat_pin(dat)
+{
+}
+
+void PS2XTimerSPI::begin()
+{
+    _clk.attach(_clk_pin);
+    _cmd.attach(_cmd_pin);
+    _att.attach(_att_pin);
+    _dat.attach(_dat_pin);
+
+    pinMode(_clk_pin, OUTPUT);    //configure ports
+    pinMode(_att_pin, OUTPUT);
+    _att.write(true);
+    pinMode(_cmd_pin, OUTPUT);
+    pinMode(_dat_pin, INPUT_PULLUP);    // enable pull-up
+
+    _clk.write(true);
+
+#if defined(ARDUINO_ARCH_ESP32)
+    if (timer == NULL)
+    {
+#    if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+        timer = timerBegin(TIMER_HZ);
+        timerAttachInterrupt(timer, &PS2XTimerSPI::onTimer);
+        timerStop(timer);
+#    else
+        timer = timerBegin(PS2X_TIMER_SPI_TIMER, 80'000'000UL / TIMER_HZ, true);
+        timerAttachInterrupt(timer, &PS2XTimerSPI::onTimer, true);
+#    endif
+    }
+#else
+    timer1_attachInterrupt(&PS2XTimerSPI::onTimer);
+#endif
+}
+
+void PS2XTimerSPI::beginTransaction()
+{
+    _cmd.write(true);
+    _clk.write(true);
+}
+
+void PS2XTimerSPI::endTransaction()
+{
+    _cmd.write(true);
+    _clk.write(true);
+}
+
+void PS2XTimerSPI::setAttention(bool active)
+{
+    _att.write(!active);    // low enable joystick
+}
+
+uint8_t PS2XTimerSPI::transfer(uint8_t out)
+{
+    uint8_t in = 0xFF;
+
+    // a single byte goes out right away, the caller spaces the bytes
+    while (!packetDone())
+        ;
+    if (start(&out, &in, 1, false))
+        while (!packetDone())
+            ;
+    return in;
+}
+
+void PS2XTimerSPI::transferPacket(const uint8_t* out, uint8_t* in, uint8_t len)
+{
+    // wait out a packet still running in the background instead of skipping this one
+    while (!packetDone())
+        ;
+    if (!start(out, in, len, true))
+        return;
+    while (!packetDone())
+        ;
+}
+
+bool PS2XTimerSPI::startPacket(const uint8_t* out, uint8_t* in, uint8_t len)
+{
+    if (!packetDone())
+        return false;
+    return start(out, in, len, true);
+}
+
+bool PS2XTimerSPI::start(const uint8_t* out, uint8_t* in, uint8_t len, bool gap)
+{
+    if (len == 0)
+        return false;
+
+    _edge_ticks = (_half_period + TIMER_NS - 1) / TIMER_NS;
+    _gap_ticks  = static_cast<uint32_t>(byteDelay()) * 1000 / TIMER_NS;
+
+    _out     = out;
+    _in      = in;
+    _len     = len;
+    _pos     = 0;
+    _bit     = 0;
+    _in_byte = 0;
+    _phase   = false;
+    _in_gap  = gap && _gap_ticks != 0;
+    _active  = this;
+    __atomic_store_n(&_done, false, __ATOMIC_RELEASE);
+
+    startTimer(_in_gap ? _gap_ticks : _edge_ticks);
+    return true;
+}
+
+bool PS2XTimerSPI::packetDone()
+{
+    return __atomic_load_n(&_done, __ATOMIC_ACQUIRE);
+}
+
+void PS2XTimerSPI::setCallback(Callback callback, void* arg)
+{
+    _callback     = callback;
+    _callback_arg = arg;
+}
+
+void PS2XTimerSPI::setClockHalfPeriod(uint16_t ns)
+{
+    _half_period = (ns < TIMER_NS) ? TIMER_NS : ns;
+}
+
+uint16_t PS2XTimerSPI::clockHalfPeriod() const
+{
+    return _half_period;
+}
+
+uint32_t PS2XTimerSPI::bitrate() const
+{
+    return 500'000'000UL / _half_period;
+}
+
+bool PS2XTimerSPI::setBitrate(uint32_t hz)
+{
+    if (hz == 0)
+        return false;
+
+    uint32_t ns = 500'000'000UL / hz;
+    setClockHalfPeriod(ns > 0xFFFF ? 0xFFFF : ns);
+    return true;
+}
+
+void IRAM_ATTR PS2XTimerSPI::onTimer()
+{
+    if (_active != nullptr)
+        _active->tick();
+}
+
+void IRAM_ATTR PS2XTimerSPI::tick()
+{
+    if (_in_gap)
+    {
+        // the byte delay took one interrupt, back to the SCK edge rate
+        _in_gap = false;
+        setAlarm(_edge_ticks);
+    }
+
+    if (!_phase)
+    {
+        // falling edge: the controller reads CMD on the rising one
+        _cmd.write(CHK(_out[_pos], _bit));
+        _clk.write(false);
+        _phase = true;
+        return;
+    }
+
+    // rising edge: DAT has settled for half a period
+    if (_dat.read())
+        bitSet(_in_byte, _bit);
+    _clk.write(true);
+    _phase = false;
+
+    if (++_bit < 8)
+        return;
+
+    _cmd.write(true);
+    if (_in != NULL)
+        _in[_pos] = _in_byte;
+    _bit     = 0;
+    _in_byte = 0;
+
+    if (++_pos < _len)
+    {
+        if (_gap_ticks != 0)
+        {
+            _in_gap = true;
+            setAlarm(_gap_ticks);
+        }
+        return;
+    }
+
+    stopTimer();
+    __atomic_store_n(&_done, true, __ATOMIC_RELEASE);
+    if (_callback != nullptr)
+        _callback(_callback_arg);
+}
+
+void PS2XTimerSPI::startTimer(uint32_t ticks)
+{
+#if defined(ARDUINO_ARCH_ESP32)
+#    if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    timerWrite(timer, 0);
+    timerAlarm(timer, ticks, true, 0);
+    timerStart(timer);
+#    else
+    timerWrite(timer, 0);
+    timerAlarmWrite(timer, ticks, true);
+    timerAlarmEnable(timer);
+#    endif
+#else
+    timer1_enable(TIM_DIV1, TIM_EDGE, TIM_LOOP);
+    timer1_write(ticks);
+#endif
+}
+
+void IRAM_ATTR PS2XTimerSPI::setAlarm(uint32_t ticks)
+{
+    // the timer reloads on every alarm, so this sets the time to the next one
+#if defined(ARDUINO_ARCH_ESP32)
+#    if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    timerAlarm(timer, ticks, true, 0);
+#    else
+    timerAlarmWrite(timer, ticks, true);
+#    endif
+#else
+    timer1_write(ticks);
+#endif
+}
+
+void IRAM_ATTR PS2XTimerSPI::stopTimer()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+#    if defined(ESP_ARDUINO_VERSION_MAJOR) && ESP_ARDUINO_VERSION_MAJOR >= 3
+    timerStop(timer);
+#    else
+    timerAlarmDisable(timer);
+#    endif
+#else
+    timer1_disable();
+#endif
+}
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "PS2X_transport.h"
+
+#if defined(ARDUINO_ARCH_ESP32) || defined(ARDUINO_ARCH_ESP8266)
+
+// hardware timer used on ESP32 cores before 3.0 (0-3), later cores pick a free one
+#ifndef PS2X_TIMER_SPI_TIMER
+#    define PS2X_TIMER_SPI_TIMER 0
+#endif
+
+/*
+ * Software SPI clocked from a hardware timer interrupt, one SCK edge (or
+ * byte delay) per interrupt, for pins without an SPI peripheral.
+ * startPacket() returns right away and the bytes are shifted in the
+ * background; PS2XCore::poll() uses that, so a frame costs the CPU only the
+ * interrupt time instead of the whole bit-banged transfer. Completion is
+ * signalled by packetDone() and an optional callback (run in interrupt
+ * context).
+ *
+ * Uses the only timer of an ESP8266 (timer1) / one ESP32 timer, so there can
+ * be one active instance at a time.
+ */
+class PS2XTimerSPI : public PS2XTransport
+{
+    // delay duration between SCK high and low (nS)
+    static constexpr uint16_t CTRL_CLK{5000};
+
+public:
+    using Callback = void (*)(void* arg);
+
+    PS2XTimerSPI() = default;
+    PS2XTimerSPI(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat);
+
+    void    begin() override;
+    void    beginTransaction() override;
+    void    endTransaction() override;
+    void    setAttention(bool active) override;
+    // blocking, a packet still running in the background is waited for first
+    uint8_t transfer(uint8_t out) override;
+    void    transferPacket(const uint8_t* out, uint8_t* in, uint8_t len) override;
+
+    bool startPacket(const uint8_t* out, uint8_t* in, uint8_t len) override;
+    bool packetDone() override;
+
+    // called from the timer interrupt after the last byte of a packet
+    void setCallback(Callback callback, void* arg = nullptr);
+
+    // SCK half period (nS), rounded to the timer resolution
+    void     setClockHalfPeriod(uint16_t ns);
+    uint16_t clockHalfPeriod() const;
+
+    uint32_t bitrate() const override;
+    bool     setBitrate(uint32_t hz) override;
+
+private:
+    static void IRAM_ATTR onTimer();
+    void IRAM_ATTR        tick();
+
+    // shift a packet in the background, gap = byteDelay() before each byte
+    bool start(const uint8_t* out, uint8_t* in, uint8_t len, bool gap);
+
+    static void startTimer(uint32_t ticks);
+    static void setAlarm(uint32_t ticks);    // next alarm of the running timer
+    static void stopTimer();
+
+    static PS2XTimerSPI* _active;    // instance the interrupt works for
+
+    uint8_t _clk_pin{0};
+    uint8_t _cmd_pin{0};
+    uint8_t _att_pin{0};
+    uint8_t _dat_pin{0};
+
+    ps2x_gpio::FastPin _clk;
+    ps2x_gpio::FastPin _cmd;
+    ps2x_gpio::FastPin _att;
+    ps2x_gpio::FastPin _dat;
+
+    uint16_t _half_period{CTRL_CLK};
+
+    Callback _callback{nullptr};
+    void*    _callback_arg{nullptr};
+
+    // packet being shifted, owned by the interrupt while _done is false
+    const uint8_t* _out{nullptr};
+    uint8_t*       _in{nullptr};
+    uint8_t        _len{0};
+    uint8_t        _pos{0};
+    uint8_t        _bit{0};
+    uint8_t        _in_byte{0};
+    bool           _phase{false};     // false = next edge is SCK low
+    bool           _in_gap{false};    // the pending interrupt ends a byte delay
+    uint32_t       _edge_ticks{0};    // SCK half period in timer ticks
+    uint32_t       _gap_ticks{0};     // byteDelay() in timer ticks
+    volatile bool  _done{true};
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "PS2X_transport.h"
+
+#define CHK(x, y) (x & (1 << y))
+
+void PS2XTransport::transferPacket(const uint8_t* out, uint8_t* in, uint8_t len)
+{
+    uint16_t byte_delay = byteDelay();
+
+    for (uint8_t i = 0; i < len; i++)
+    {
+        uint8_t tmp = transfer(out[i]);
+        if (in != NULL)
+            in[i] = tmp;
+        delayMicroseconds(byte_delay);
+    }
+}
+
+bool PS2XTransport::startPacket(const uint8_t*, uint8_t*, uint8_t)
+{
+    return false;
+}
+
+bool PS2XTransport::packetDone()
+{
+    return true;
+}
+
+uint16_t PS2XTransport::byteDelay() const
+{
+    return _byte_delay;
+}
+
+bool PS2XTransport::setByteDelay(uint16_t us)
+{
+    _byte_delay = us;
+    return true;
+}
+
+uint32_t PS2XTransport::bitrate() const
+{
+    return 0;
+}
+
+bool PS2XTransport::setBitrate(uint32_t)
+{
+    return false;
+}
+
+#if defined(ARDUINO)
+PS2XSoftwareSPI::PS2XSoftwareSPI(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat)
+    : _clk_pin(clk), _cmd_pin(cmd), _att_pin(att), _dat_pin(dat)
+{
+}
+
+void PS2XSoftwareSPI::begin()
+{
+    _clk.attach(_clk_pin);
+    _cmd.attach(_cmd_pin);
+    _att.attach(_att_pin);
+    _dat.attach(_dat_pin);
+    setClockHalfPeriod(_half_period);
+
+    pinMode(_clk_pin, OUTPUT);    //configure ports
+    pinMode(_att_pin, OUTPUT);
+    _att.write(true);
+    pinMode(_cmd_pin, OUTPUT);
+    pinMode(_dat_pin, INPUT_PULLUP);    // enable pull-up
+
+    _clk.write(true);
+}
+
+void PS2XSoftwareSPI::beginTransaction()
+{
+    _cmd.write(true);
+    _clk.write(true);
+}
+
+void PS2XSoftwareSPI::endTransaction()
+{
+    _cmd.write(true);
+    _clk.write(true);
+}
+
+void PS2XSoftwareSPI::setAttention(bool active)
+{
+    _att.write(!active);    // low enable joystick
+}
+
+uint8_t PS2XSoftwareSPI::transfer(uint8_t out)
+{
+    uint8_t tmp = 0;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        _cmd.write(CHK(out, i));
+
+        _clk.write(false);
+        ps2x_gpio::delayTicks(_half_period_ticks);
+
+        if (_dat.read())
+            bitSet(tmp, i);
+
+        _clk.write(true);
+        ps2x_gpio::delayTicks(_half_period_ticks);
+    }
+    _cmd.write(true);
+    return tmp;
+}
+
+void PS2XSoftwareSPI::setClockHalfPeriod(uint16_t ns)
+{
+    _half_period       = ns;
+    _half_period_ticks = ps2x_gpio::nsToTicks(ns);
+}
+
+uint16_t PS2XSoftwareSPI::clockHalfPeriod() const
+{
+    return _half_period;
+}
+
+uint32_t PS2XSoftwareSPI::bitrate() const
+{
+    return 500'000'000UL / (_half_period != 0 ? _half_period : 1);
+}
+
+bool PS2XSoftwareSPI::setBitrate(uint32_t hz)
+{
+    if (hz == 0)
+        return false;
+
+    uint32_t ns = 500'000'000UL / hz;
+    setClockHalfPeriod(ns > 0xFFFF ? 0xFFFF : ns);
+    return true;
+}
+#endif
+
+#if defined(SPI_HAS_TRANSACTION)
+PS2XHardwareSPI::PS2XHardwareSPI(SPIClass* spi, uint8_t att, bool begin_bus)
+    : _spi(spi), _att_pin(att), _begin_bus(begin_bus)
+{
+}
+
+void PS2XHardwareSPI::begin()
+{
+    pinMode(_att_pin, OUTPUT);
+    setAttention(false);
+
+    _spi_settings = SPISettings(_bitrate, LSBFIRST, SPI_MODE3);
+
+    if (_begin_bus)
+        _spi->begin();    // begin SPI with default settings
+
+    /* some hardware SPI implementations incorrectly hold CLK low before the first transaction, so we'll try to fix that */
+    beginTransaction();
+    _spi->transfer(0x55);    // anything will work here
+    endTransaction();
+}
+
+void PS2XHardwareSPI::beginTransaction()
+{
+    _spi->beginTransaction(_bulk ? _bulk_settings : _spi_settings);
+}
+
+void PS2XHardwareSPI::endTransaction()
+{
+    _spi->endTransaction();
+}
+
+void PS2XHardwareSPI::setAttention(bool active)
+{
+    digitalWrite(_att_pin, active ? LOW : HIGH);
+}
+
+uint8_t PS2XHardwareSPI::transfer(uint8_t out)
+{
+    return _spi->transfer(out);
+}
+
+uint32_t PS2XHardwareSPI::bitrate() const
+{
+    return _bulk ? _bulk_bitrate : _bitrate;
+}
+
+bool PS2XHardwareSPI::setBitrate(uint32_t hz)
+{
+    if (hz == 0)
+        return false;
+
+    _bitrate       = hz;
+    _bulk_bitrate  = hz;
+    _spi_settings  = SPISettings(_bitrate, LSBFIRST, SPI_MODE3);
+    _bulk_settings = SPISettings(_bulk_bitrate, LSBFIRST, SPI_MODE3);
+    return true;
+}
+
+void PS2XHardwareSPI::transferPacket(const uint8_t* out, uint8_t* in, uint8_t len)
+{
+    if (!_bulk)
+    {
+        PS2XTransport::transferPacket(out, in, len);
+        return;
+    }
+
+    uint8_t scratch[32];
+    if (in == NULL)
+    {
+        // replies are discarded, but the buffer based APIs still need somewhere to put them
+        for (uint8_t done = 0; done < len; done += sizeof(scratch))
+        {
+            uint8_t chunk = len - done;
+            if (chunk > sizeof(scratch))
+                chunk = sizeof(scratch);
+            transferPacket(out + done, scratch, chunk);
+        }
+        return;
+    }
+
+#if defined(ARDUINO_ARCH_ESP32)
+    _spi->transferBytes(out, in, len);
+#else
+    memcpy(in, out, len);
+    _spi->transfer(in, len);    // in-place
+#endif
+}
+
+void PS2XHardwareSPI::setBulkTransfer(bool enable, uint32_t bitrate)
+{
+    _bulk = enable;
+    if (bitrate != 0)
+        _bulk_bitrate = bitrate;
+    _bulk_settings = SPISettings(_bulk_bitrate, LSBFIRST, SPI_MODE3);
+}
+
+bool PS2XHardwareSPI::bulkTransfer() const
+{
+    return _bulk;
+}
+#endif
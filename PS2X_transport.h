@@ -0,0 +1,238 @@
+#pragma once
+
+#include "PS2X_gpio.h"
+#include "PS2X_platform.h"
+
+#if defined(ARDUINO)
+#include <SPI.h>
+#endif
+
+/*
+ * Bus access used by PS2X. A transport clocks bytes (LSB first, SPI mode 3),
+ * owns the bit and inter-byte timing and drives the ATT line; packet spacing
+ * is handled by PS2X itself.
+ */
+class PS2XTransport
+{
+protected:
+    // delay duration between byte reads (uS)
+    static constexpr uint16_t CTRL_BYTE_DELAY{18};
+
+public:
+    // configure pins / peripheral, called once from PS2X::begin()
+    virtual void begin() = 0;
+
+    // claim / release the bus around a packet (ATT is switched separately)
+    virtual void beginTransaction() = 0;
+    virtual void endTransaction()   = 0;
+
+    // drive ATT (active = low = controller selected)
+    virtual void setAttention(bool active) = 0;
+
+    // exchange one byte, no trailing delay
+    virtual uint8_t transfer(uint8_t out) = 0;
+
+    // exchange len bytes waiting byteDelay() after each one, in may be NULL
+    virtual void transferPacket(const uint8_t* out, uint8_t* in, uint8_t len);
+
+    // clock len bytes in the background (ATT already asserted), with
+    // byteDelay() before each byte. Returns false if the transport can't, the
+    // caller then uses transfer() / transferPacket(). packetDone() turns true
+    // once the last byte is in; in may be NULL.
+    virtual bool startPacket(const uint8_t* out, uint8_t* in, uint8_t len);
+    virtual bool packetDone();
+
+    // delay between bytes (uS), returns false if it is fixed
+    virtual uint16_t byteDelay() const;
+    virtual bool     setByteDelay(uint16_t us);
+
+    // SCK frequency (Hz), bitrate() = 0 and setBitrate() = false if the
+    // transport has no adjustable clock
+    virtual uint32_t bitrate() const;
+    virtual bool     setBitrate(uint32_t hz);
+
+protected:
+    ~PS2XTransport() = default;
+
+    uint16_t _byte_delay{CTRL_BYTE_DELAY};
+};
+
+
+#if defined(ARDUINO)
+// bit-banged SPI on any four GPIOs, pin registers are looked up in begin()
+class PS2XSoftwareSPI : public PS2XTransport
+{
+    // delay duration between SCK high and low (nS)
+    static constexpr uint16_t CTRL_CLK{5000};
+
+public:
+    PS2XSoftwareSPI() = default;
+    PS2XSoftwareSPI(uint8_t clk, uint8_t cmd, uint8_t att, uint8_t dat);
+
+    void    begin() override;
+    void    beginTransaction() override;
+    void    endTransaction() override;
+    void    setAttention(bool active) override;
+    uint8_t transfer(uint8_t out) override;
+
+    // SCK half period (nS). Most controllers are fine well below the default
+    // 5uS; sub-microsecond values are only honored on ESP32/ESP8266.
+    void     setClockHalfPeriod(uint16_t ns);
+    uint16_t clockHalfPeriod() const;
+
+    // same clock as a frequency
+    uint32_t bitrate() const override;
+    bool     setBitrate(uint32_t hz) override;
+
+private:
+    uint8_t _clk_pin{0};
+    uint8_t _cmd_pin{0};
+    uint8_t _att_pin{0};
+    uint8_t _dat_pin{0};
+
+    ps2x_gpio::FastPin _clk;
+    ps2x_gpio::FastPin _cmd;
+    ps2x_gpio::FastPin _att;
+    ps2x_gpio::FastPin _dat;
+
+    uint16_t _half_period{CTRL_CLK};
+    uint32_t _half_period_ticks{0};    // _half_period in ps2x_gpio::delayTicks() units
+};
+#endif
+
+
+#if defined(SPI_HAS_TRANSACTION)
+// hardware SPI peripheral, ATT driven as a GPIO. Packets are clocked byte by
+// byte with byteDelay() in between, or - with setBulkTransfer() - as a single
+// buffered SPI transfer without CPU paced gaps.
+class PS2XHardwareSPI : public PS2XTransport
+{
+    // SPI bitrate (Hz)
+    static constexpr uint32_t CTRL_BITRATE{250'000UL};
+
+public:
+    PS2XHardwareSPI() = default;
+    // begin_bus = false if spi->begin() has already been called (e.g. with custom pins)
+    PS2XHardwareSPI(SPIClass* spi, uint8_t att, bool begin_bus = true);
+
+    void    begin() override;
+    void    beginTransaction() override;
+    void    endTransaction() override;
+    void    setAttention(bool active) override;
+    uint8_t transfer(uint8_t out) override;
+    void    transferPacket(const uint8_t* out, uint8_t* in, uint8_t len) override;
+
+    // clock in effect (the bulk one while in bulk mode), setting it applies
+    // to both modes
+    uint32_t bitrate() const override;
+    bool     setBitrate(uint32_t hz) override;
+
+    // whole packet transfers leave no gap between bytes: fine for most pads,
+    // keep it off for controllers that need ACK paced timing. bitrate (Hz, 0 =
+    // keep the current one) lets the bytes be stretched by the peripheral
+    // instead.
+    void setBulkTransfer(bool enable, uint32_t bitrate = 0);
+    bool bulkTransfer() const;
+
+private:
+    SPIClass*   _spi{NULL};
+    SPISettings _spi_settings;    // hardware SPI transaction settings
+    SPISettings _bulk_settings;    // transaction settings while in bulk mode
+    uint32_t    _bitrate{CTRL_BITRATE};
+    uint32_t    _bulk_bitrate{CTRL_BITRATE};
+    uint8_t     _att_pin{0};
+    bool        _begin_bus{true};
+    bool        _bulk{false};
+};
+#endif
+
+
+#if defined(ARDUINO)
+// bit-banged SPI with pins and timing fixed at compile time: the whole packet
+// loop is inlined, meant for PS2XStatic. Pins are direct register accesses on
+// ESP32 and ESP8266 only; on AVR and other cores every pin access is still a
+// digitalWrite() / digitalRead() call (see PS2X_gpio.h).
+template <uint8_t CLK, uint8_t CMD, uint8_t ATT, uint8_t DAT, uint16_t ClkDelay = 5, uint16_t ByteDelay = 18>
+class PS2XStaticSoftwareSPI : public PS2XTransport
+{
+public:
+    void begin() override
+    {
+        pinMode(CLK, OUTPUT);    //configure ports
+        pinMode(ATT, OUTPUT);
+        ps2x_gpio::write<ATT>(true);
+        pinMode(CMD, OUTPUT);
+        pinMode(DAT, INPUT_PULLUP);    // enable pull-up
+
+        ps2x_gpio::write<CLK>(true);
+    }
+
+    void beginTransaction() override
+    {
+        ps2x_gpio::write<CMD>(true);
+        ps2x_gpio::write<CLK>(true);
+    }
+
+    void endTransaction() override
+    {
+        ps2x_gpio::write<CMD>(true);
+        ps2x_gpio::write<CLK>(true);
+    }
+
+    void setAttention(bool active) override
+    {
+        ps2x_gpio::write<ATT>(!active);
+    }
+
+    uint8_t transfer(uint8_t out) override
+    {
+        return shift(out);
+    }
+
+    void transferPacket(const uint8_t* out, uint8_t* in, uint8_t len) override
+    {
+        for (uint8_t i = 0; i < len; i++)
+        {
+            uint8_t tmp = shift(out[i]);
+            if (in != NULL)
+                in[i] = tmp;
+            if (ByteDelay != 0)
+                delayMicroseconds(ByteDelay);
+        }
+    }
+
+    uint16_t byteDelay() const override
+    {
+        return ByteDelay;
+    }
+
+    bool setByteDelay(uint16_t) override
+    {
+        return false;
+    }
+
+private:
+    static inline uint8_t shift(uint8_t out)
+    {
+        uint8_t tmp = 0;
+
+        for (uint8_t i = 0; i < 8; i++)
+        {
+            ps2x_gpio::write<CMD>(out & (1 << i));
+
+            ps2x_gpio::write<CLK>(false);
+            if (ClkDelay != 0)
+                delayMicroseconds(ClkDelay);
+
+            if (ps2x_gpio::read<DAT>())
+                tmp |= (1 << i);
+
+            ps2x_gpio::write<CLK>(true);
+            if (ClkDelay != 0)
+                delayMicroseconds(ClkDelay);
+        }
+        ps2x_gpio::write<CMD>(true);
+        return tmp;
+    }
+};
+#endif
@@ -0,0 +1,50 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * Reads the controller every 10 mS while it is in use and backs
+ * off to a 100 mS heartbeat after 2 s without input. The loop
+ * sleeps for the current interval, so an idle controller costs
+ * 10 bus transactions and wakeups per second instead of 100.
+ ******************************************************************/
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+PS2X ps2x; // create PS2 Controller Class
+
+int error = 0;
+
+void setup(){
+  Serial.begin(115200);
+  delay(300);  //give wireless ps2 module some time to startup
+
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, false, false);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+
+  // 10 mS active, 100 mS idle heartbeat after 2 s, ramped over 1 s
+  ps2x.setPollSchedule(PS2X::PollSchedule{10, 100, 2000, 1000});
+  // ignore stick jitter when deciding whether the pad is idle
+  ps2x.setChangeThreshold(4);
+}
+
+void loop() {
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  static uint16_t last_interval = 0;
+
+  ps2x.readGamepad();
+  if (ps2x.wasPressed(PS2X::Button::Cross))
+    Serial.println("Cross pressed");
+
+  uint16_t interval = ps2x.pollInterval();
+  if (interval != last_interval) {
+    Serial.print("poll interval (mS): ");
+    Serial.println(interval);
+    last_interval = interval;
+  }
+
+  delay(interval);
+}
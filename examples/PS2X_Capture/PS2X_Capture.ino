@@ -0,0 +1,67 @@
+#include <PS2X_lib.h>
+#include <PS2X_capture.h>
+
+/******************************************************************
+ * set pins connected to PS2 controller
+ * replace pin numbers by the ones you use
+ ******************************************************************/
+#define PS2_DAT        13
+#define PS2_CMD        11
+#define PS2_SEL        10
+#define PS2_CLK        12
+
+/* records begin() and a few seconds of polling, then prints the trace
+   as a C array - paste it into a host program and play it back with
+   PS2XReplay to reproduce exactly what the controller sent */
+#define CAPTURE_MS     3000
+
+PS2XSoftwareSPI bus(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT);
+uint8_t         trace[1024];
+PS2XMemorySink  sink(trace, sizeof(trace));
+PS2XCapture     capture(bus, sink);
+PS2X            ps2x;
+
+int error = 0;
+unsigned long start;
+
+void setup(){
+  Serial.begin(57600);
+
+  delay(300);  //give wireless ps2 module some time to startup
+
+  error = ps2x.begin(capture, true, true);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+
+  start = millis();
+}
+
+void loop() {
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  ps2x.readGamepad(false, 0);
+  delay(20);
+
+  if(millis() - start < CAPTURE_MS)
+    return;
+
+  capture.setEnabled(false);
+
+  Serial.print("// packets: ");
+  Serial.print(capture.packets());
+  Serial.print(", dropped: ");
+  Serial.println(capture.dropped());
+  Serial.println("const uint8_t trace[] = {");
+  for(size_t i = 0; i < sink.size(); i++) {
+    Serial.print("0x");
+    if(trace[i] < 0x10)
+      Serial.print("0");
+    Serial.print(trace[i], HEX);
+    Serial.print((i % 16 == 15) ? ",\n" : ", ");
+  }
+  Serial.println("\n};");
+
+  while(true)
+    delay(1000);
+}
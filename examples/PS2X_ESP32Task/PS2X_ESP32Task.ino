@@ -0,0 +1,46 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * ESP32 only: the controller is polled by a background task on
+ * core 0, the loop on core 1 never waits for the bus.
+ ******************************************************************/
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+#define POLL_PERIOD_MS 16
+
+PS2X ps2x; // create PS2 Controller Class
+
+uint32_t last_frame = 0;
+
+void setup(){
+  Serial.begin(115200);
+  delay(300);  //give wireless ps2 module some time to startup
+
+  if(ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, false, true) != 0)
+    Serial.println("No controller found or controller not accepting commands");
+
+  ps2x.startTask(POLL_PERIOD_MS, 0);
+}
+
+void loop() {
+  // one consistent frame, no matter what the polling task does meanwhile
+  PS2X::Snapshot pad = ps2x.snapshot();
+  if(pad.frame == last_frame)
+    return;
+  last_frame = pad.frame;
+
+  if(pad.isPressed(PS2X::Button::Cross))
+    ps2x.setTaskMotors(false, 0xFF);
+  else
+    ps2x.setTaskMotors(false, 0);
+
+  if(pad.isPressed(PS2X::Button::L1)) {
+    Serial.print("Left stick: ");
+    Serial.print(pad.analog(PS2X::AnalogButton::Stick_Lx), DEC);
+    Serial.print(",");
+    Serial.println(pad.analog(PS2X::AnalogButton::Stick_Ly), DEC);
+  }
+}
@@ -0,0 +1,99 @@
+#include <PS2X_lib.h>
+#include <PS2X_gesture.h>
+
+/******************************************************************
+ * Recognizes a few combos from a constexpr table on the live
+ * controller, and times the recognizer with 128 registered
+ * patterns on generated button frames.
+ ******************************************************************/
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+#define BENCH_PATTERNS 128
+#define BENCH_FRAMES   10000
+
+using namespace ps2x_gesture;
+
+constexpr Pattern COMBOS[] = {
+  chord(2000, PS2X::Button::L1, PS2X::Button::R1, PS2X::Button::Start),
+  sequence(PS2X::Button::Pad_Up, PS2X::Button::Pad_Up, PS2X::Button::Pad_Down, PS2X::Button::Pad_Down,
+           PS2X::Button::Pad_Left, PS2X::Button::Pad_Right, PS2X::Button::Pad_Left, PS2X::Button::Pad_Right),
+  exactChord(0, PS2X::Button::Cross, PS2X::Button::Circle),
+};
+
+const char* const combo_names[] = {"L1+R1+Start held 2s", "up up down down left right left right", "cross+circle"};
+
+PS2X ps2x; // create PS2 Controller Class
+PS2XGestures<4> combos;
+PS2XGestures<BENCH_PATTERNS, BENCH_PATTERNS * 4> bench;
+
+int error = 0;
+
+void setup(){
+  Serial.begin(115200);
+  delay(300);  //give wireless ps2 module some time to startup
+
+  combos.add(COMBOS, sizeof(COMBOS) / sizeof(COMBOS[0]));
+
+  // random chords and sequences of 2-7 steps
+  randomSeed(1);
+  for (uint8_t i = 0; i < BENCH_PATTERNS; i++) {
+    Pattern p = (i & 1) ? chord(random(0, 1000), PS2X::Button::Select) : sequence(PS2X::Button::Select);
+    if (i & 1) {
+      p.keys[0] = bit(random(16)) | bit(random(16)) | bit(random(16));
+    } else {
+      p.length = random(2, 8);
+      for (uint8_t k = 0; k < p.length; k++)
+        p.keys[k] = bit(random(16));
+    }
+    bench.add(p);
+  }
+
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, false, false);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+  ps2x.attachGestures(&combos);
+}
+
+void loop() {
+  // timed on generated frames: a few buttons pressed at random, 16 mS apart
+  static uint16_t frames[64];
+  for (uint8_t i = 0; i < 64; i++)
+    frames[i] = random(0x10000) & random(0x10000) & random(0x10000);
+
+  PS2XGestureEngine::Event event;
+  uint32_t events = 0;
+  uint32_t now = 0;
+
+  unsigned long start = micros();
+  for (uint16_t n = 0; n < BENCH_FRAMES; n++) {
+    bench.update(frames[n & 63], now += 16);
+    while (bench.readEvent(event))
+      events++;
+  }
+  unsigned long bench_us = micros() - start;
+
+  Serial.print(bench.size());
+  Serial.print(" patterns, per frame (ns): ");
+  Serial.print(bench_us * 1000.0 / BENCH_FRAMES);
+  Serial.print("  gestures: ");
+  Serial.println(events);
+
+  if(error == 1) { //no live controller
+    delay(1000);
+    return;
+  }
+
+  // live controller: the recognizer runs inside readGamepad()
+  unsigned long until = millis() + 1000;
+  while ((long)(until - millis()) > 0) {
+    ps2x.readGamepad();
+    while (combos.readEvent(event)) {
+      Serial.print("combo: ");
+      Serial.println(combo_names[event.id]);
+    }
+    delay(16);
+  }
+}
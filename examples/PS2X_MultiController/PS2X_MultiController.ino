@@ -0,0 +1,64 @@
+#include <PS2X_lib.h>
+#include <PS2X_bus.h>
+
+/******************************************************************
+ * set pins connected to the PS2 controllers: CLK, CMD and DAT are
+ * shared, every controller gets its own SEL (ATT) line
+ * replace pin numbers by the ones you use
+ ******************************************************************/
+#define PS2_DAT        13
+#define PS2_CMD        11
+#define PS2_CLK        12
+const uint8_t PS2_SEL[] = {10, 9, 8, 7};
+
+#define PADS           (sizeof(PS2_SEL) / sizeof(PS2_SEL[0]))
+
+PS2XBus bus;
+PS2X    pads[PADS];
+
+unsigned long last_report = 0;
+
+void setup(){
+  Serial.begin(57600);
+
+  // deselect all controllers before the first one is configured
+  for(uint8_t i = 0; i < PADS; i++) {
+    pinMode(PS2_SEL[i], OUTPUT);
+    digitalWrite(PS2_SEL[i], HIGH);
+  }
+
+  delay(300);  //give wireless ps2 module some time to startup
+
+  bus.begin(PS2_CLK, PS2_CMD, PS2_DAT);
+  for(uint8_t i = 0; i < PADS; i++) {
+    if(bus.addController(pads[i], PS2_SEL[i], false, true) != 0) {
+      Serial.print("No controller found on SEL pin ");
+      Serial.println(PS2_SEL[i]);
+    }
+  }
+}
+
+void loop() {
+  /* update() clocks at most one byte and interleaves the controllers'
+     packets, so all of them run at close to the single-pad frame rate */
+  int8_t pad = bus.update();
+  if(pad >= 0) {
+    if(pads[pad].wasPressed(PS2X::Button::Cross)) {
+      Serial.print("X pressed on pad ");
+      Serial.println(pad);
+    }
+    // rumble while Circle is held
+    bus.setMotors(pad, pads[pad].isPressed(PS2X::Button::Circle), 0);
+  }
+
+  if(millis() - last_report >= 5000) {
+    last_report = millis();
+    for(uint8_t i = 0; i < bus.controllers(); i++) {
+      Serial.print("pad ");
+      Serial.print(i);
+      Serial.print(": ");
+      Serial.print(bus.frameRate(i));
+      Serial.println(" Hz");
+    }
+  }
+}
@@ -0,0 +1,59 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * set pins connected to the multitap
+ * replace pin numbers by the ones you use
+ ******************************************************************/
+#define PS2_DAT        13
+#define PS2_CMD        11
+#define PS2_SEL        10
+#define PS2_CLK        12
+
+PS2X ps2x; // create PS2 Controller Class
+
+int error = 0;
+
+void setup(){
+  Serial.begin(57600);
+
+  delay(300);  //give wireless ps2 module some time to startup
+
+  // begin() talks to the controller in port A
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, false, true);
+  if(error != 0) {
+    Serial.println("No controller found in port A");
+    return;
+  }
+
+  if(!ps2x.enableMultitap()) {
+    Serial.println("No multitap found");
+    error = 1;
+    return;
+  }
+
+  for(uint8_t port = 0; port < PS2X::MULTITAP_PORTS; port++) {
+    Serial.print("Port ");
+    Serial.print((char)('A' + port));
+    Serial.println(ps2x.portConnected(port) ? ": controller" : ": empty");
+  }
+}
+
+void loop() {
+  if(error != 0)
+    return;
+
+  // one packet reads all four ports
+  ps2x.readGamepad(false, 0);
+
+  for(uint8_t port = 0; port < PS2X::MULTITAP_PORTS; port++) {
+    if(ps2x.wasPressed(port, PS2X::Button::Cross)) {
+      Serial.print("X pressed on port ");
+      Serial.println((char)('A' + port));
+    }
+    // rumble ports B-D while Circle is held
+    if(port != 0)
+      ps2x.setPortMotors(port, ps2x.isPressed(port, PS2X::Button::Circle), 0);
+  }
+
+  delay(20);
+}
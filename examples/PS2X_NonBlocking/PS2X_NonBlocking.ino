@@ -0,0 +1,56 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * set pins connected to PS2 controller
+ * replace pin numbers by the ones you use
+ ******************************************************************/
+#define PS2_DAT        13
+#define PS2_CMD        11
+#define PS2_SEL        10
+#define PS2_CLK        12
+
+PS2X ps2x; // create PS2 Controller Class
+
+int error = 0;
+unsigned long work_loops = 0;
+
+void setup(){
+  Serial.begin(57600);
+
+  delay(300);  //give wireless ps2 module some time to startup
+
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, false, false);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+}
+
+void loop() {
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  /* poll() never waits for the bus: it clocks at most one byte per call
+     and tells when a complete frame has been decoded */
+  switch(ps2x.poll()) {
+    case PS2X::PollStatus::Ready:
+      if(ps2x.wasPressed(PS2X::Button::Cross))
+        Serial.println("X just pressed");
+      if(ps2x.isPressed(PS2X::Button::L1)) {
+        Serial.print("Left stick: ");
+        Serial.print(ps2x.analog(PS2X::AnalogButton::Stick_Lx), DEC);
+        Serial.print(",");
+        Serial.println(ps2x.analog(PS2X::AnalogButton::Stick_Ly), DEC);
+      }
+      Serial.print("loops between frames: ");
+      Serial.println(work_loops);
+      work_loops = 0;
+      break;
+    case PS2X::PollStatus::Error:
+      Serial.println("controller left analog mode, reconfiguring");
+      break;
+    case PS2X::PollStatus::Busy:
+      break;
+  }
+
+  // motor, sensor, ... work keeps running between bus bytes
+  work_loops++;
+}
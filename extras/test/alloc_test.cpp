@@ -0,0 +1,156 @@
+/*
+ * Host test: one million simulated polls must not touch the heap.
+ *
+ * Every global operator new / malloc is counted; the controller is set up
+ * (begin() is allowed to do one-time work), then readGamepad() and poll()
+ * run against a PS2XSimController with events, snapshots, a stick pipeline,
+ * rumble and the stream encoder in the loop. Any allocation fails the test.
+ */
+#include "PS2X_lib.h"
+#include "PS2X_sim.h"
+#include "PS2X_stream.h"
+
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+
+namespace
+{
+    constexpr uint32_t POLLS = 1'000'000UL;
+
+    volatile bool     counting    = false;
+    volatile uint32_t allocations = 0;
+
+    void count()
+    {
+        if (counting)
+            allocations = allocations + 1;
+    }
+}    // namespace
+
+// C allocations from the library code, linked with -Wl,--wrap=malloc,...
+extern "C"
+{
+    void* __real_malloc(size_t size);
+    void* __real_calloc(size_t n, size_t size);
+    void* __real_realloc(void* ptr, size_t size);
+
+    void* __wrap_malloc(size_t size)
+    {
+        count();
+        return __real_malloc(size);
+    }
+
+    void* __wrap_calloc(size_t n, size_t size)
+    {
+        count();
+        return __real_calloc(n, size);
+    }
+
+    void* __wrap_realloc(void* ptr, size_t size)
+    {
+        count();
+        return __real_realloc(ptr, size);
+    }
+}
+
+void* operator new(size_t size)
+{
+    count();
+    if (void* ptr = __real_malloc(size != 0 ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+int main()
+{
+    ps2x_host::useVirtualClock(true);
+
+    PS2XSimController pad;
+    PS2X              ps2x;
+    PS2XRumble        rumble;
+    PS2XStick         stick(PS2XStick::Config{PS2XStick::Calibration::Center, PS2XStick::Deadzone::Radial, 80,
+                                      &ps2x_stick::EXPO, PS2XStick::Filter::Ema, 64, 0, 0});
+    PS2XStreamEncoder encoder;
+
+    if (ps2x.begin(pad, false, true) != 0)
+    {
+        printf("FAIL: begin() found no controller\n");
+        return 1;
+    }
+    ps2x.attachStick(PS2X::Stick::Left, &stick);
+    ps2x.attachRumble(&rumble);
+    rumble.play(PS2XRumble::Effect{PS2XRumble::Motor::Both, 200, 10, 20, 10, 50, PS2XRumble::FOREVER, 0});
+
+    uint8_t           packet[ps2x_stream::MAX_PACKET];
+    PS2X::ButtonEvent event;
+    uint32_t          frames = 0;
+
+    counting = true;
+    for (uint32_t i = 0; i < POLLS; i++)
+    {
+        pad.setButton(PS2X::Button::Cross, (i & 8) != 0);
+        pad.setAnalog(PS2X::AnalogButton::Stick_Lx, static_cast<uint8_t>(i));
+
+        if ((i & 1) == 0)
+        {
+            frames += ps2x.readGamepad() ? 1 : 0;
+        }
+        else
+        {
+            // one frame through the non-blocking path
+            PS2X::PollStatus status;
+            while ((status = ps2x.poll()) == PS2X::PollStatus::Busy)
+                ps2x_host::advanceClock(100);
+            frames += (status == PS2X::PollStatus::Ready) ? 1 : 0;
+        }
+
+        while (ps2x.readEvent(event))
+            ;
+        encoder.encode(ps2x, packet);
+        (void) ps2x.snapshot();
+        (void) ps2x.state();
+    }
+    counting = false;
+
+    printf("%lu polls, %lu valid frames, %lu heap allocations\n", static_cast<unsigned long>(POLLS),
+           static_cast<unsigned long>(frames), static_cast<unsigned long>(allocations));
+
+    if (frames != POLLS)
+    {
+        printf("FAIL: not every poll returned a valid frame\n");
+        return 1;
+    }
+    if (allocations != 0)
+    {
+        printf("FAIL: the poll path allocated\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,327 @@
+/*
+ * Host test: PS2X against simulated controllers.
+ *
+ * Each test sets up a PS2XSimController (or a PS2XSimMultitap), drives it
+ * through readGamepad() / poll() on the virtual clock and checks what the
+ * application gets to see. Failed checks are printed with their line, the
+ * exit code is the number of them.
+ */
+#include "PS2X_lib.h"
+#include "PS2X_sim.h"
+
+#include <stdio.h>
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+namespace
+{
+    uint32_t failures = 0;
+
+    void check(bool ok, const char* what, int line)
+    {
+        if (ok)
+            return;
+        printf("FAIL line %d: %s\n", line, what);
+        failures++;
+    }
+
+    constexpr PS2X::RetryPolicy FAIL_FAST{1, PS2X::Backoff::Fixed, 0, 10, 50, true};
+
+    // one frame through the non-blocking path
+    PS2X::PollStatus pollFrame(PS2X& ps2x)
+    {
+        PS2X::PollStatus status;
+        while ((status = ps2x.poll()) == PS2X::PollStatus::Busy)
+            ps2x_host::advanceClock(100);
+        return status;
+    }
+
+    // presses and releases show up once, through the accessors and the event queue
+    void testButtonEdges()
+    {
+        PS2XSimController pad;
+        PS2X              ps2x;
+        PS2X::ButtonEvent event;
+
+        CHECK(ps2x.begin(pad, false, false) == 0);
+        while (ps2x.readEvent(event))
+            ;
+
+        pad.setButton(PS2X::Button::Cross, true);
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.isPressed(PS2X::Button::Cross));
+        CHECK(ps2x.wasPressed(PS2X::Button::Cross));
+        CHECK(!ps2x.wasPressed(PS2X::Button::Circle));
+        CHECK(ps2x.readEvent(event));
+        CHECK(event.button == PS2X::Button::Cross && event.pressed);
+        CHECK(!ps2x.readEvent(event));
+
+        // held: no new edge
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.isPressed(PS2X::Button::Cross));
+        CHECK(!ps2x.wasPressed(PS2X::Button::Cross));
+        CHECK(!ps2x.readEvent(event));
+
+        pad.setButton(PS2X::Button::Cross, false);
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Ready);
+        CHECK(!ps2x.isPressed(PS2X::Button::Cross));
+        CHECK(ps2x.wasReleased(PS2X::Button::Cross));
+        CHECK(ps2x.readEvent(event));
+        CHECK(event.button == PS2X::Button::Cross && !event.pressed);
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Ready);
+        CHECK(!ps2x.wasReleased(PS2X::Button::Cross));
+    }
+
+    // the default policy retries and reconfigures within the same call
+    void testRetry()
+    {
+        PS2XSimController pad;
+        PS2X              ps2x;
+
+        CHECK(ps2x.begin(pad, false, false) == 0);
+        pad.setButton(PS2X::Button::Square, true);
+
+        pad.corruptFrames(2);
+        CHECK(ps2x.readGamepad());
+        CHECK(!ps2x.stale());
+        CHECK(ps2x.wasPressed(PS2X::Button::Square));
+
+        pad.dropAnalogMode();
+        CHECK(ps2x.readGamepad());
+        CHECK(pad.modeId() == 0x73);
+        CHECK(!ps2x.wasPressed(PS2X::Button::Square));
+    }
+
+    // fail fast through readGamepad(): a bad frame keeps the last good one
+    // without repeating its edges, the reconfiguration follows one packet per call
+    void testFailFastRead()
+    {
+        PS2XSimController pad;
+        PS2X              ps2x;
+
+        CHECK(ps2x.begin(pad, false, false) == 0);
+        ps2x.setRetryPolicy(FAIL_FAST);
+        pad.setAnalog(PS2X::AnalogButton::Stick_Lx, 0x10);
+        pad.setButton(PS2X::Button::Cross, true);
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.wasPressed(PS2X::Button::Cross));
+
+        pad.corruptFrames(1);
+        CHECK(!ps2x.readGamepad());
+        CHECK(ps2x.stale());
+        CHECK(ps2x.isPressed(PS2X::Button::Cross));
+        CHECK(!ps2x.wasPressed(PS2X::Button::Cross));
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Lx) == 0x10);
+
+        uint8_t calls = 1;
+        while (!ps2x.readGamepad() && calls < 20)
+        {
+            CHECK(!ps2x.wasPressed(PS2X::Button::Cross));
+            calls++;
+        }
+        CHECK(calls < 10);
+        CHECK(!ps2x.stale());
+        CHECK(!ps2x.wasPressed(PS2X::Button::Cross));
+
+        pad.dropAnalogMode();
+        calls = 1;
+        while (!ps2x.readGamepad() && calls < 20)
+            calls++;
+        CHECK(calls < 10);
+        CHECK(pad.modeId() == 0x73);
+    }
+
+    // fail fast through poll(): a frame that had to be replaced is an Error
+    // and gets the controller reconfigured right away
+    void testFailFastPoll()
+    {
+        PS2XSimController pad;
+        PS2X              ps2x;
+
+        CHECK(ps2x.begin(pad, false, false) == 0);
+        ps2x.setRetryPolicy(FAIL_FAST);
+        pad.setButton(PS2X::Button::Cross, true);
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Ready);
+        CHECK(ps2x.wasPressed(PS2X::Button::Cross));
+
+        pad.corruptFrames(1);
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Error);
+        CHECK(ps2x.stale());
+        CHECK(ps2x.isPressed(PS2X::Button::Cross));
+        CHECK(!ps2x.wasPressed(PS2X::Button::Cross));
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Ready);
+        CHECK(!ps2x.stale());
+        CHECK(!ps2x.wasPressed(PS2X::Button::Cross));
+
+        pad.dropAnalogMode();
+        uint8_t frames = 1;
+        while (pollFrame(ps2x) != PS2X::PollStatus::Ready && frames < 20)
+            frames++;
+        CHECK(frames < 5);
+        CHECK(pad.modeId() == 0x73);
+    }
+
+    // unplugged and plugged back in: lost, probed, reconfigured
+    void testReconnect()
+    {
+        PS2XSimController     pad;
+        PS2X                  ps2x;
+        PS2X::ConnectionEvent event;
+
+        CHECK(ps2x.begin(pad, false, false) == 0);
+        while (ps2x.readConnectionEvent(event))
+            ;
+
+        pad.setConnected(false);
+        CHECK(!ps2x.readGamepad());
+        CHECK(ps2x.connection() == PS2X::Connection::Lost);
+        CHECK(ps2x.readConnectionEvent(event));
+        CHECK(event.state == PS2X::Connection::Lost);
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Error);
+
+        // power loss reset the pad to digital mode, it has to come back in analog mode
+        pad.setConnected(true);
+        pad.setButton(PS2X::Button::Start, true);
+        uint16_t calls = 0;
+        while (!ps2x.readGamepad() && calls < 10)
+        {
+            ps2x_host::advanceClock(ps2x.probeInterval() * 1000UL);
+            calls++;
+        }
+        CHECK(calls < 10);
+        CHECK(ps2x.connection() == PS2X::Connection::Connected);
+        CHECK(pad.modeId() == 0x73);
+        CHECK(ps2x.isPressed(PS2X::Button::Start));
+
+        bool connected = false;
+        while (ps2x.readConnectionEvent(event))
+            connected = (event.state == PS2X::Connection::Connected);
+        CHECK(connected);
+
+        // the same through poll()
+        pad.setConnected(false);
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Error);
+        CHECK(ps2x.connection() == PS2X::Connection::Lost);
+        pad.setConnected(true);
+        calls = 0;
+        while (pollFrame(ps2x) != PS2X::PollStatus::Ready && calls < 10)
+        {
+            ps2x_host::advanceClock(ps2x.probeInterval() * 1000UL);
+            calls++;
+        }
+        CHECK(calls < 10);
+        CHECK(ps2x.connection() == PS2X::Connection::Connected);
+        CHECK(pad.modeId() == 0x73);
+    }
+
+    // all four ports in one packet, empty ones reported as such
+    void testMultitap()
+    {
+        PS2XSimMultitap   tap;
+        PS2XSimController pad_a;
+        PS2XSimController pad_c;
+        PS2X              ps2x;
+
+        tap.plug(0, &pad_a);
+        tap.plug(2, &pad_c);
+        CHECK(ps2x.begin(tap, false, false) == 0);
+        CHECK(ps2x.enableMultitap());
+        CHECK(ps2x.multitap());
+        CHECK(tap.batched());
+        CHECK(pad_a.modeId() == 0x73);
+        CHECK(pad_c.modeId() == 0x73);
+
+        pad_a.setAnalog(PS2X::AnalogButton::Stick_Lx, 0x30);
+        pad_c.setButton(PS2X::Button::Triangle, true);
+        pad_c.setAnalog(PS2X::AnalogButton::Stick_Ry, 0xC0);
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.portConnected(0));
+        CHECK(!ps2x.portConnected(1));
+        CHECK(ps2x.portConnected(2));
+        CHECK(!ps2x.portConnected(3));
+        CHECK(ps2x.analog(0, PS2X::AnalogButton::Stick_Lx) == 0x30);
+        CHECK(ps2x.isPressed(2, PS2X::Button::Triangle));
+        CHECK(ps2x.wasPressed(2, PS2X::Button::Triangle));
+        CHECK(!ps2x.isPressed(0, PS2X::Button::Triangle));
+        CHECK(ps2x.analog(2, PS2X::AnalogButton::Stick_Ry) == 0xC0);
+
+        // port A also feeds the single controller accessors
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Lx) == 0x30);
+
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.isPressed(2, PS2X::Button::Triangle));
+        CHECK(!ps2x.wasPressed(2, PS2X::Button::Triangle));
+        CHECK(ps2x.poll() == PS2X::PollStatus::Error);
+    }
+
+    // stick and pressure bytes of the frame, whatever mode it was read in
+    void testDataModes()
+    {
+        PS2XSimController pad;
+        PS2X              ps2x;
+
+        CHECK(ps2x.begin(pad, false, false) == 0);
+        CHECK(pad.modeId() == 0x73);
+
+        pad.setAnalog(PS2X::AnalogButton::Stick_Lx, 0x20);
+        pad.setAnalog(PS2X::AnalogButton::Stick_Ry, 0xE0);
+        pad.setAnalog(PS2X::AnalogButton::Cross, 0x99);
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Lx) == 0x20);
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Ry) == 0xE0);
+        CHECK(ps2x.analog(PS2X::AnalogButton::Cross) == 0x00);
+
+        CHECK(ps2x.setDataMode(PS2X::DataMode::Pressures));
+        CHECK(pad.modeId() == 0x79);
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Lx) == 0x20);
+        CHECK(ps2x.analog(PS2X::AnalogButton::Cross) == 0x99);
+
+        // back to analog: the 0x4F mask has to keep the sticks and only drop the pressures
+        CHECK(ps2x.setDataMode(PS2X::DataMode::Analog));
+        CHECK(pad.modeId() == 0x73);
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Lx) == 0x20);
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Ry) == 0xE0);
+        CHECK(ps2x.analog(PS2X::AnalogButton::Cross) == 0x00);
+
+        // digital: short frames, buttons only
+        pad.setButton(PS2X::Button::Select, true);
+        CHECK(ps2x.setDataMode(PS2X::DataMode::Digital));
+        CHECK(pad.modeId() == 0x41);
+        uint32_t packets = pad.packets();
+        CHECK(pollFrame(ps2x) == PS2X::PollStatus::Ready);
+        CHECK(pad.packets() == packets + 1);
+        CHECK(ps2x.isPressed(PS2X::Button::Select));
+        CHECK(ps2x.analog(PS2X::AnalogButton::Stick_Lx) == 0x80);
+
+        // a Guitar Hero controller has no pressures, the mode stays
+        PS2XSimController guitar(PS2XSimController::Model::GuitarHero);
+        PS2X              ps2x_guitar;
+        CHECK(ps2x_guitar.begin(guitar, false, false) == 0);
+        CHECK(!ps2x_guitar.setDataMode(PS2X::DataMode::Pressures));
+        CHECK(ps2x_guitar.dataMode() == PS2X::DataMode::Analog);
+        CHECK(ps2x_guitar.readGamepad());
+    }
+}    // namespace
+
+int main()
+{
+    ps2x_host::useVirtualClock(true);
+
+    testButtonEdges();
+    testRetry();
+    testFailFastRead();
+    testFailFastPoll();
+    testReconnect();
+    testMultitap();
+    testDataModes();
+
+    if (failures != 0)
+    {
+        printf("%lu checks failed\n", static_cast<unsigned long>(failures));
+        return static_cast<int>(failures);
+    }
+    printf("PASS\n");
+    return 0;
+}
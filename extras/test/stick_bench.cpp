@@ -0,0 +1,72 @@
+/*
+ * Host benchmark: the PS2XStick pipeline against per read float math, with
+ * the loops of examples/PS2X_StickPipeline over more frames. Not a test,
+ * nothing to pass; run ps2x_stick_bench directly.
+ */
+#include "PS2X_stick.h"
+
+#include <math.h>
+#include <stdio.h>
+
+namespace
+{
+    constexpr uint32_t BENCH_FRAMES    = 1'000'000UL;
+    constexpr uint8_t  READS_PER_FRAME = 8;
+
+    // the per call float version: normalize, radial deadzone, expo, EMA
+    float smooth_x = 0, smooth_y = 0;
+
+    float naiveX(uint8_t raw_x, uint8_t raw_y)
+    {
+        float x = (raw_x - 128) / 127.5f;
+        float y = (raw_y - 128) / 127.5f;
+        float m = sqrtf(x * x + y * y);
+        if (m < 0.08f)
+            return smooth_x *= 0.75f;
+        float n = (m - 0.08f) / 0.92f;
+        if (n > 1)
+            n = 1;
+        n = 0.5f * n + 0.5f * powf(n, 3);
+        smooth_x += (x / m * n - smooth_x) * 0.25f;
+        smooth_y += (y / m * n - smooth_y) * 0.25f;
+        return smooth_x * 1024;
+    }
+
+    double nsPer(uint32_t us, uint32_t count)
+    {
+        return us * 1000.0 / count;
+    }
+}    // namespace
+
+int main()
+{
+    volatile long sink = 0;
+    PS2XStick     bench(PS2XStick::Config{PS2XStick::Calibration::Center, PS2XStick::Deadzone::Radial, 80,
+                                      &ps2x_stick::EXPO, PS2XStick::Filter::Ema, 64, 0, 0});
+
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+        bench.update(i * 7, i * 13, i * 16000UL);
+    uint32_t update_us = micros() - start;
+
+    start = micros();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+    {
+        for (uint8_t r = 0; r < READS_PER_FRAME; r++)
+            sink = sink + bench.x();
+    }
+    uint32_t read_us = micros() - start;
+
+    start = micros();
+    for (uint32_t i = 0; i < BENCH_FRAMES; i++)
+    {
+        for (uint8_t r = 0; r < READS_PER_FRAME; r++)
+            sink = sink + naiveX(i * 7, i * 13);
+    }
+    uint32_t float_us = micros() - start;
+
+    printf("%lu frames, %u reads per frame\n", static_cast<unsigned long>(BENCH_FRAMES), READS_PER_FRAME);
+    printf("update %.1f ns per frame, cached read %.1f ns, float %.1f ns per read\n", nsPer(update_us, BENCH_FRAMES),
+           nsPer(read_us, BENCH_FRAMES * READS_PER_FRAME), nsPer(float_us, BENCH_FRAMES * READS_PER_FRAME));
+    return 0;
+}
@@ -0,0 +1,336 @@
+/*
+ * Host test: PS2XStreamEncoder -> PS2XStreamDecoder round trips.
+ *
+ * Covers the LEB128 field mask, CRC-8 rejection of corrupted packets, lost
+ * packets and frames the encoder skipped, and the value range each
+ * quantization keeps. Failed checks are printed with their line, the exit
+ * code is the number of them.
+ */
+#include "PS2X_lib.h"
+#include "PS2X_sim.h"
+#include "PS2X_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+using Result = PS2XStreamDecoder::Result;
+
+namespace
+{
+    uint32_t failures = 0;
+
+    void check(bool ok, const char* what, int line)
+    {
+        if (ok)
+            return;
+        printf("FAIL line %d: %s\n", line, what);
+        failures++;
+    }
+
+    PS2XControllerState restState()
+    {
+        PS2XControllerState state;
+        memset(&state, 0, sizeof(state));
+        memset(state.sticks, 0x80, sizeof(state.sticks));
+        return state;
+    }
+
+    bool sameState(const PS2XControllerState& a, const PS2XControllerState& b)
+    {
+        return memcmp(&a, &b, sizeof(a)) == 0;
+    }
+
+    // byte by byte, as from a UART; the result of the last complete packet
+    Result pushAll(PS2XStreamDecoder& decoder, const uint8_t* data, uint8_t len)
+    {
+        Result result = Result::None;
+        for (uint8_t i = 0; i < len; i++)
+        {
+            Result r = decoder.push(data[i]);
+            if (r != Result::None)
+                result = r;
+        }
+        return result;
+    }
+
+    // keyframe, then deltas with only what changed
+    void testRoundTrip()
+    {
+        PS2XStreamEncoder   encoder;
+        PS2XStreamDecoder   decoder;
+        PS2XControllerState state = restState();
+        uint8_t             packet[ps2x_stream::MAX_PACKET];
+
+        state.pressed                                = 0x4001;
+        state.sticks[PS2XControllerState::LX]        = 0x12;
+        state.pressures[PS2XControllerState::SQUARE] = 0xC8;
+
+        uint8_t len = encoder.encode(state, packet);
+        CHECK(len != 0);
+        CHECK((packet[1] & 0x03) == 0);    // keyframe
+        CHECK(pushAll(decoder, packet, len) == Result::Frame);
+        CHECK(decoder.synced());
+        CHECK(sameState(decoder.state(), state));
+        CHECK(decoder.isPressed(0x4000));
+
+        // nothing changed, nothing to send
+        CHECK(encoder.encode(state, packet) == 0);
+
+        state.sticks[PS2XControllerState::RY] = 0x00;
+        len                                   = encoder.encode(state, packet);
+        CHECK((packet[1] & 0x03) == 1);    // delta
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.changed() == (1UL << (PS2XControllerState::RY + 1)));
+        CHECK(sameState(decoder.state(), state));
+
+        // full keyframe: every field away from rest
+        for (uint8_t i = 0; i < PS2XControllerState::AXES; i++)
+            state.sticks[i] = 0x10 + i;
+        for (uint8_t i = 0; i < PS2XControllerState::PRESSURES; i++)
+            state.pressures[i] = 0xA0 + i;
+        encoder.requestKeyframe();
+        len = encoder.encode(state, packet);
+        CHECK(len == ps2x_stream::MAX_PACKET);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(sameState(decoder.state(), state));
+    }
+
+    // the field mask takes 1, 2 or 3 LEB128 bytes depending on its highest bit
+    void testFieldMask()
+    {
+        PS2XStreamEncoder   encoder;
+        PS2XStreamDecoder   decoder;
+        PS2XControllerState state = restState();
+        uint8_t             packet[ps2x_stream::MAX_PACKET];
+
+        uint8_t len = encoder.encode(state, packet);
+        CHECK(len == 7);    // header, mask 0x01, buttons, CRC
+        CHECK(packet[3] == 0x01);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+
+        // buttons only: one byte
+        state.pressed = 0x0008;
+        len           = encoder.encode(state, packet);
+        CHECK(packet[3] == 0x01);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.changed() == ps2x_stream::FIELD_BUTTONS);
+
+        // bit 7 (DOWN): two bytes
+        state.pressures[PS2XControllerState::DOWN] = 0x40;
+        len                                        = encoder.encode(state, packet);
+        CHECK(packet[3] == 0x80 && packet[4] == 0x01);
+        CHECK(len == 3 + 2 + 1 + 1);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.changed() == (1UL << 7));
+
+        // bit 16 (R2): three bytes
+        state.pressures[PS2XControllerState::R2] = 0xFF;
+        len                                      = encoder.encode(state, packet);
+        CHECK(packet[3] == 0x80 && packet[4] == 0x80 && packet[5] == 0x04);
+        CHECK(len == 3 + 3 + 1 + 1);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.changed() == (1UL << 16));
+        CHECK(decoder.analog(static_cast<uint8_t>(PS2X::AnalogButton::R2)) == 0xFF);
+        CHECK(sameState(decoder.state(), state));
+    }
+
+    // a flipped bit anywhere is dropped; the delta after it is a gap until the next keyframe
+    void testCrc()
+    {
+        PS2XStreamEncoder   encoder;
+        PS2XStreamDecoder   decoder;
+        PS2XControllerState state = restState();
+        uint8_t             packet[ps2x_stream::MAX_PACKET];
+
+        uint8_t len = encoder.encode(state, packet);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+
+        state.sticks[PS2XControllerState::LX] = 0x33;
+        len                                   = encoder.encode(state, packet);
+        for (uint8_t i = 1; i < len; i++)
+        {
+            uint8_t corrupted[ps2x_stream::MAX_PACKET];
+            memcpy(corrupted, packet, len);
+            corrupted[i] ^= 0x10;
+            CHECK(decoder.decode(corrupted, len) == Result::CrcError);
+        }
+        CHECK(decoder.crcErrors() == static_cast<uint32_t>(len - 1));
+        CHECK(decoder.state().sticks[PS2XControllerState::LX] == 0x80);
+
+        // the same through push(), with line noise in front
+        const uint8_t noise[] = {0x00, 0x13, 0x37};
+        uint8_t       corrupted[ps2x_stream::MAX_PACKET];
+        memcpy(corrupted, packet, len);
+        corrupted[len - 1] ^= 0x01;
+        pushAll(decoder, noise, sizeof(noise));
+        CHECK(pushAll(decoder, corrupted, len) == Result::CrcError);
+        CHECK(pushAll(decoder, packet, len) == Result::Frame);
+        CHECK(decoder.state().sticks[PS2XControllerState::LX] == 0x33);
+
+        // the intact packet was lost: the next delta can't be applied
+        state.sticks[PS2XControllerState::LX] = 0x44;
+        len                                   = encoder.encode(state, packet);
+        packet[len - 2] ^= 0xFF;
+        CHECK(decoder.decode(packet, len) == Result::CrcError);
+        state.sticks[PS2XControllerState::LY] = 0x55;
+        len                                   = encoder.encode(state, packet);
+        CHECK(decoder.decode(packet, len) == Result::Gap);
+        CHECK(!decoder.synced());
+        CHECK(decoder.state().sticks[PS2XControllerState::LY] == 0x80);
+
+        encoder.requestKeyframe();
+        len = encoder.encode(state, packet);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.synced());
+        CHECK(sameState(decoder.state(), state));
+    }
+
+    // lost packets show up as sequence gaps, the keyframe interval recovers from them
+    void testSequenceGaps()
+    {
+        PS2XStreamEncoder   encoder(8, 4);
+        PS2XStreamDecoder   decoder;
+        PS2XControllerState state = restState();
+        uint8_t             packet[ps2x_stream::MAX_PACKET];
+
+        uint8_t len = encoder.encode(state, packet);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+
+        uint8_t frames = 0;
+        uint8_t gaps   = 0;
+        for (uint8_t i = 1; i <= 8; i++)
+        {
+            state.sticks[PS2XControllerState::RX] = i;
+            len                                   = encoder.encode(state, packet);
+            CHECK(packet[2] == i);    // sequence number
+            if (i == 2)
+                continue;    // lost
+            Result result = decoder.decode(packet, len);
+            frames += (result == Result::Frame) ? 1 : 0;
+            gaps += (result == Result::Gap) ? 1 : 0;
+        }
+        // 1 arrives; 3 and 4 are gaps; 5 is the keyframe after 4 deltas; 6-8 apply on top
+        CHECK(frames == 5);
+        CHECK(gaps == 2);
+        CHECK(decoder.gaps() == 2);
+        CHECK(sameState(decoder.state(), state));
+
+        // 256 packets later the sequence number wraps around without a gap
+        for (uint16_t i = 1; i <= 300; i++)
+        {
+            state.pressed = i;
+            len           = encoder.encode(state, packet);
+            CHECK(decoder.decode(packet, len) == Result::Frame);
+        }
+        CHECK(decoder.gaps() == 2);
+    }
+
+    // encode(ps2x) called less often than frames are polled: a change that only
+    // shows in the dirty mask of a skipped frame must still get sent
+    void testSkippedFrames()
+    {
+        PS2XSimController pad;
+        PS2X              ps2x;
+        PS2XStreamEncoder encoder(8, 0);
+        PS2XStreamDecoder decoder;
+        uint8_t           packet[ps2x_stream::MAX_PACKET];
+
+        CHECK(ps2x.begin(pad, false, false) == 0);
+        CHECK(ps2x.readGamepad());
+        uint8_t len = encoder.encode(ps2x, packet);
+        CHECK(len != 0);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(encoder.encode(ps2x, packet) == 0);    // same frame
+
+        pad.setAnalog(PS2X::AnalogButton::Stick_Lx, 0x10);
+        pad.setButton(PS2X::Button::Circle, true);
+        CHECK(ps2x.readGamepad());
+        CHECK(ps2x.readGamepad());    // nothing dirty in this one
+        len = encoder.encode(ps2x, packet);
+        CHECK(len != 0);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.analog(static_cast<uint8_t>(PS2X::AnalogButton::Stick_Lx)) == 0x10);
+        CHECK(decoder.isPressed(static_cast<uint16_t>(PS2X::Button::Circle)));
+
+        // next frame only: the dirty mask is enough
+        pad.setAnalog(PS2X::AnalogButton::Stick_Ry, 0xF0);
+        CHECK(ps2x.readGamepad());
+        len = encoder.encode(ps2x, packet);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.changed() == (1UL << (PS2XControllerState::RY + 1)));
+        CHECK(sameState(decoder.state(), ps2x.state()));
+    }
+
+    // what each quantization keeps: rest values, both ends, and the step in between
+    void testQuantization()
+    {
+        const uint8_t bits[] = {8, 6, 5, 4};
+        for (uint8_t b : bits)
+        {
+            uint8_t step = 1 << (8 - b);
+            for (uint16_t v = 0; v <= 0xFF; v++)
+            {
+                PS2XStreamEncoder   encoder(b);
+                PS2XStreamDecoder   decoder;
+                PS2XControllerState state = restState();
+                uint8_t             packet[ps2x_stream::MAX_PACKET];
+
+                state.sticks[PS2XControllerState::LY]    = v;
+                state.pressures[PS2XControllerState::L1] = v;
+                uint8_t len                              = encoder.encode(state, packet);
+                CHECK(((packet[1] >> 2) & 0x03) == (b == 8 ? 0 : b == 6 ? 1 : b == 5 ? 2 : 3));
+                CHECK(decoder.decode(packet, len) == Result::Frame);
+
+                uint8_t expected = (v >= 0x100 - step) ? 0xFF : (v & ~(step - 1));
+                CHECK(decoder.state().sticks[PS2XControllerState::LY] == expected);
+                CHECK(decoder.state().pressures[PS2XControllerState::L1] == expected);
+                CHECK(decoder.state().sticks[PS2XControllerState::LX] == 0x80);
+                CHECK(decoder.state().pressures[PS2XControllerState::R1] == 0x00);
+            }
+
+            // all 16 analog fields at full deflection fit the packet
+            PS2XStreamEncoder   encoder(b);
+            PS2XStreamDecoder   decoder;
+            PS2XControllerState state;
+            uint8_t             packet[ps2x_stream::MAX_PACKET];
+            memset(&state, 0xFF, sizeof(state));
+            uint8_t len = encoder.encode(state, packet);
+            CHECK(len == 3 + 3 + 2 + (16 * b + 7) / 8 + 1);
+            CHECK(decoder.decode(packet, len) == Result::Frame);
+            CHECK(sameState(decoder.state(), state));
+        }
+
+        // unsupported bit counts fall back to 8
+        PS2XStreamEncoder   encoder(7);
+        PS2XStreamDecoder   decoder;
+        PS2XControllerState state = restState();
+        uint8_t             packet[ps2x_stream::MAX_PACKET];
+        state.sticks[PS2XControllerState::RX] = 0x81;
+        uint8_t len                           = encoder.encode(state, packet);
+        CHECK(((packet[1] >> 2) & 0x03) == 0);
+        CHECK(decoder.decode(packet, len) == Result::Frame);
+        CHECK(decoder.state().sticks[PS2XControllerState::RX] == 0x81);
+    }
+}    // namespace
+
+int main()
+{
+    ps2x_host::useVirtualClock(true);
+
+    testRoundTrip();
+    testFieldMask();
+    testCrc();
+    testSequenceGaps();
+    testSkippedFrames();
+    testQuantization();
+
+    if (failures != 0)
+    {
+        printf("%lu checks failed\n", static_cast<unsigned long>(failures));
+        return static_cast<int>(failures);
+    }
+    printf("PASS\n");
+    return 0;
+}